@@ -0,0 +1,35 @@
+#pragma once
+
+#include <algorithm>
+
+//Turns variable frame times into a whole number of fixed size physics steps.
+//Leftover time carries over to the next frame, and alpha() says how far between two steps the frame is drawn.
+struct FixedTimestep
+{
+    float step;        //Length of one physics step
+    int maxSubsteps;   //Most steps run in one frame, so a slow frame can't snowball into even slower ones
+    float accumulator = 0.f;
+
+public:
+    FixedTimestep(float step, int maxSubsteps) : step(step), maxSubsteps(std::max(maxSubsteps, 1)) {}
+
+    //Adds the time the last frame took and returns how many physics steps to run now
+    int advance(float frameTime)
+    {
+        accumulator += frameTime;
+
+        int steps = static_cast<int>(accumulator / step);
+        if (steps > maxSubsteps)
+        {
+            //Can't keep up, drop the time we have no budget for instead of carrying it forever
+            steps = maxSubsteps;
+            accumulator = step * steps;
+        }
+
+        accumulator -= step * steps;
+        return steps;
+    }
+
+    //0 = draw at the previous step, 1 = draw at the latest step
+    float alpha() const { return std::clamp(accumulator / step, 0.f, 1.f); }
+};
@@ -0,0 +1,46 @@
+#include "Input.h"
+
+void InputQueue::handleEvent(const sf::Event& event)
+{
+    if (event.is<sf::Event::Closed>())
+    {
+        actions.push_back({ InputActionType::Quit, {} });
+    }
+    else if (const auto* released = event.getIf<sf::Event::MouseButtonReleased>())
+    {
+        if (released->button == sf::Mouse::Button::Left)
+        {
+            actions.push_back({ InputActionType::Click, released->position });
+        }
+    }
+    else if (const auto* scrolled = event.getIf<sf::Event::MouseWheelScrolled>())
+    {
+        if (scrolled->wheel == sf::Mouse::Wheel::Vertical)
+        {
+            actions.push_back({ InputActionType::Zoom, scrolled->position, scrolled->delta });
+        }
+    }
+    else if (const auto* released = event.getIf<sf::Event::KeyReleased>())
+    {
+        if (released->code == sf::Keyboard::Key::Escape)
+        {
+            actions.push_back({ InputActionType::ToggleMenu, {} });
+        }
+        else if (released->code == sf::Keyboard::Key::F3)
+        {
+            actions.push_back({ InputActionType::ToggleProfiler, {} });
+        }
+        else if (released->code == sf::Keyboard::Key::F4)
+        {
+            actions.push_back({ InputActionType::WriteTrace, {} });
+        }
+        else if (released->code == sf::Keyboard::Key::F5)
+        {
+            actions.push_back({ InputActionType::SaveSnapshot, {} });
+        }
+        else if (released->code == sf::Keyboard::Key::F9)
+        {
+            actions.push_back({ InputActionType::LoadSnapshot, {} });
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <SFML/Window/Event.hpp>
+#include <vector>
+
+//Things the player asked for this frame, worked out from window events
+enum class InputActionType
+{
+    Click,      //Left mouse button released, at pixel
+    ToggleMenu, //Escape released
+    ToggleProfiler, //F3 released
+    WriteTrace, //F4 released
+    SaveSnapshot, //F5 released
+    LoadSnapshot, //F9 released
+    Zoom,       //Mouse wheel scrolled at pixel, wheelDelta > 0 zooms in
+    Quit        //Window close button
+};
+
+struct InputAction
+{
+    InputActionType type;
+    sf::Vector2i pixel; //Where the mouse was, only used by Click and Zoom
+    float wheelDelta = 0.f;
+};
+
+//Turns SFML events into actions that get handled once per frame.
+//Buttons and keys trigger on release, so holding one down doesn't repeat it and nothing has to wait for it to be let go.
+struct InputQueue
+{
+    std::vector<InputAction> actions;
+
+public:
+    void handleEvent(const sf::Event& event);
+    void clear() { actions.clear(); }
+};
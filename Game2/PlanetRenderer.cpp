@@ -0,0 +1,116 @@
+#include "PlanetRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+void buildPlanetVertices(const std::vector<RenderPlanet>& planets, float alpha,
+    const sf::FloatRect& visibleArea, std::vector<sf::Vertex>& vertices, float textureSize)
+{
+    //resize keeps the capacity, so this only allocates when there are more planets than ever before.
+    //Sized for every planet, then trimmed to the ones that were actually on screen
+    vertices.resize(planets.size() * 6);
+
+    const float visibleLeft = visibleArea.position.x;
+    const float visibleRight = visibleArea.position.x + visibleArea.size.x;
+    const float visibleTop = visibleArea.position.y;
+    const float visibleBottom = visibleArea.position.y + visibleArea.size.y;
+
+    const sf::Vector2f texTopLeft(0.f, 0.f);
+    const sf::Vector2f texTopRight(textureSize, 0.f);
+    const sf::Vector2f texBottomLeft(0.f, textureSize);
+    const sf::Vector2f texBottomRight(textureSize, textureSize);
+
+    sf::Vertex* vertex = vertices.data();
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        const RenderPlanet& planet = planets[i];
+        sf::Vector2f position = planet.previousPosition + (planet.position - planet.previousPosition) * alpha;
+
+        const float radius = planet.radius;
+        const float left = position.x - radius;
+        const float right = position.x + radius;
+        const float top = position.y - radius;
+        const float bottom = position.y + radius;
+        if (right < visibleLeft || left > visibleRight || bottom < visibleTop || top > visibleBottom)
+        {
+            continue;
+        }
+
+        vertex[0] = { { left, top }, planet.color, texTopLeft };
+        vertex[1] = { { right, top }, planet.color, texTopRight };
+        vertex[2] = { { left, bottom }, planet.color, texBottomLeft };
+        vertex[3] = { { left, bottom }, planet.color, texBottomLeft };
+        vertex[4] = { { right, top }, planet.color, texTopRight };
+        vertex[5] = { { right, bottom }, planet.color, texBottomRight };
+        vertex += 6;
+    }
+    vertices.resize(vertex - vertices.data());
+}
+
+PlanetRenderer::PlanetRenderer()
+{
+    //White filled circle with a one pixel soft edge, the vertex colour tints it per planet
+    sf::Image circle({ circleTextureSize, circleTextureSize }, sf::Color::Transparent);
+    const float center = circleTextureSize / 2.f;
+    for (unsigned y = 0; y < circleTextureSize; ++y)
+    {
+        for (unsigned x = 0; x < circleTextureSize; ++x)
+        {
+            float dx = x + 0.5f - center;
+            float dy = y + 0.5f - center;
+            float coverage = std::clamp(center - std::sqrt(dx * dx + dy * dy), 0.f, 1.f);
+            circle.setPixel({ x, y }, sf::Color(255, 255, 255, static_cast<std::uint8_t>(coverage * 255)));
+        }
+    }
+
+    if (!circleTexture.loadFromImage(circle))
+    {
+        std::cerr << "Couldn't create the planet texture" << std::endl;
+    }
+    circleTexture.setSmooth(true);
+    //Mipmaps keep small planets from shimmering when the texture is shrunk a lot
+    if (!circleTexture.generateMipmap())
+    {
+        std::cerr << "Couldn't create planet texture mipmaps" << std::endl;
+    }
+
+    useVertexBuffer = sf::VertexBuffer::isAvailable();
+}
+
+void PlanetRenderer::draw(sf::RenderTarget& target, const std::vector<RenderPlanet>& planets, float alpha)
+{
+    if (planets.empty())
+    {
+        return;
+    }
+
+    const sf::View& view = target.getView();
+    sf::FloatRect visibleArea(view.getCenter() - view.getSize() / 2.f, view.getSize());
+    buildPlanetVertices(planets, alpha, visibleArea, vertices, static_cast<float>(circleTextureSize));
+    if (vertices.empty())
+    {
+        return;
+    }
+
+    sf::RenderStates states;
+    states.texture = &circleTexture;
+
+    if (useVertexBuffer)
+    {
+        //Only recreate the GPU buffer when it needs to grow, otherwise just stream the new vertices in
+        if (vertexBuffer.getVertexCount() < vertices.size())
+        {
+            useVertexBuffer = vertexBuffer.create(vertices.capacity());
+        }
+        if (useVertexBuffer && vertexBuffer.update(vertices.data(), vertices.size(), 0))
+        {
+            target.draw(vertexBuffer, 0, vertices.size(), states);
+            return;
+        }
+        useVertexBuffer = false;
+    }
+
+    target.draw(vertices.data(), vertices.size(), sf::PrimitiveType::Triangles, states);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "Physics.h"
+
+//Writes planets as textured quads (2 triangles each) into one vertex array, so the whole set is a single draw call.
+//The quads use a white circle texture that gets tinted by each planet's colour.
+//Planets are placed alpha of the way from their previous position to their current one (0 = previous, 1 = current).
+//Planets entirely outside visibleArea (world units) are left out.
+void buildPlanetVertices(const std::vector<RenderPlanet>& planets, float alpha,
+    const sf::FloatRect& visibleArea, std::vector<sf::Vertex>& vertices, float textureSize);
+
+//Draws every planet with one draw call, instead of a CircleShape and draw call per planet
+struct PlanetRenderer
+{
+    //Size of the generated circle texture in pixels, big enough that large planets still look round
+    static constexpr unsigned circleTextureSize = 256;
+
+    sf::Texture circleTexture;
+    std::vector<sf::Vertex> vertices;
+    sf::VertexBuffer vertexBuffer{ sf::PrimitiveType::Triangles, sf::VertexBuffer::Usage::Stream };
+    bool useVertexBuffer = false; //Falls back to drawing straight from the vertex array if the GPU has no vertex buffers
+
+public:
+    //Needs an OpenGL context, so make it after the window
+    PlanetRenderer();
+
+    //Draws through the target's current view, planets are in world units (meters)
+    void draw(sf::RenderTarget& target, const std::vector<RenderPlanet>& planets, float alpha);
+};
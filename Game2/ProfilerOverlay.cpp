@@ -0,0 +1,114 @@
+#include "ProfilerOverlay.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+ProfilerOverlay::ProfilerOverlay()
+    : columns{ sf::Text(font, "", characterSize), sf::Text(font, "", characterSize),
+               sf::Text(font, "", characterSize), sf::Text(font, "", characterSize) }
+{
+    fontLoaded = font.openFromFile("Assets/Fonts/RobotoCondensed.ttf");
+    if (!fontLoaded)
+    {
+        std::cerr << "Couldn't load Assets/Fonts/RobotoCondensed.ttf, the profiler overlay is off" << std::endl;
+    }
+
+    const float columnX[4] = { 10.f, 110.f, 175.f, 240.f };
+    for (std::size_t i = 0; i < columns.size(); ++i)
+    {
+        columns[i].setFillColor(sf::Color::White);
+        columns[i].setPosition({ columnX[i], 8.f });
+    }
+
+    background.setFillColor(sf::Color(0, 0, 0, 170));
+    background.setPosition({ 0.f, 0.f });
+}
+
+void ProfilerOverlay::refresh(FrameProfiler& profiler, FrameProfiler* simulationProfiler)
+{
+    std::ostringstream names, means, p95s, p99s;
+    means << std::fixed << std::setprecision(2);
+    p95s << std::fixed << std::setprecision(2);
+    p99s << std::fixed << std::setprecision(2);
+
+    //One block of rows per profiler. With a simulation thread each side leaves out the phases the other one runs
+    auto addSection = [&](const char* title, FrameProfiler& section, bool skipEmpty)
+    {
+        names << title << ", ms, " << section.sampleCount() << "\n";
+        means << "mean\n";
+        p95s << "p95\n";
+        p99s << "p99\n";
+
+        double total = 0.0;
+        for (std::size_t i = 0; i < FrameProfiler::phaseCount; ++i)
+        {
+            ProfilePhase phase = static_cast<ProfilePhase>(i);
+            PhaseStats stats = section.stats(phase);
+            if (skipEmpty && stats.p99 <= 0.0)
+            {
+                continue;
+            }
+            total += stats.mean;
+            names << profilePhaseName(phase) << "\n";
+            means << stats.mean << "\n";
+            p95s << stats.p95 << "\n";
+            p99s << stats.p99 << "\n";
+        }
+        names << "Total\n";
+        means << total << "\n";
+        p95s << "\n";
+        p99s << "\n";
+    };
+
+    if (!profilerEnabled)
+    {
+        names << "Profiler compiled out (GAME2_DISABLE_PROFILER)";
+    }
+    else if (simulationProfiler)
+    {
+        addSection("Frames", profiler, true);
+        addSection("Sim ticks", *simulationProfiler, true);
+    }
+    else
+    {
+        addSection("Frames", profiler, false);
+    }
+
+    columns[0].setString(names.str());
+    columns[1].setString(means.str());
+    columns[2].setString(p95s.str());
+    columns[3].setString(p99s.str());
+
+    //Background covers every column plus a margin
+    float right = 0.f;
+    float bottom = 0.f;
+    for (const sf::Text& column : columns)
+    {
+        sf::FloatRect bounds = column.getGlobalBounds();
+        right = std::max(right, bounds.position.x + bounds.size.x);
+        bottom = std::max(bottom, bounds.position.y + bounds.size.y);
+    }
+    background.setSize({ right + 10.f, bottom + 10.f });
+}
+
+void ProfilerOverlay::draw(sf::RenderTarget& target, FrameProfiler& profiler, FrameProfiler* simulationProfiler)
+{
+    if (!isOpen || !fontLoaded)
+    {
+        return;
+    }
+
+    if (--framesUntilRefresh <= 0)
+    {
+        refresh(profiler, simulationProfiler);
+        framesUntilRefresh = refreshFrames;
+    }
+
+    target.draw(background);
+    for (const sf::Text& column : columns)
+    {
+        target.draw(column);
+    }
+}
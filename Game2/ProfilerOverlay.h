@@ -0,0 +1,34 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <array>
+#include "Profiler.h"
+
+//Table of how long each phase of the frame takes (mean, p95, p99 over the last few seconds), drawn in the top left.
+//With a simulation thread its ticks get a section of their own under the frame's. Draw it through a view in pixels.
+struct ProfilerOverlay
+{
+    //The numbers are unreadable if they change every frame, so the text is only rebuilt this often
+    static constexpr int refreshFrames = 15;
+    static constexpr unsigned characterSize = 16;
+
+    sf::Font font;
+    bool fontLoaded = false;
+    std::array<sf::Text, 4> columns; //Phase name, mean, p95, p99, one column each so the numbers line up
+    sf::RectangleShape background;
+    int framesUntilRefresh = 0;
+
+public:
+    bool isOpen = false;
+
+    ProfilerOverlay();
+
+    //Holds on to font, can't be copied
+    ProfilerOverlay(const ProfilerOverlay&) = delete;
+    ProfilerOverlay& operator=(const ProfilerOverlay&) = delete;
+
+    void draw(sf::RenderTarget& target, FrameProfiler& profiler, FrameProfiler* simulationProfiler = nullptr);
+
+private:
+    void refresh(FrameProfiler& profiler, FrameProfiler* simulationProfiler);
+};
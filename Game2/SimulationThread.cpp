@@ -0,0 +1,149 @@
+#include "SimulationThread.h"
+
+#include "Snapshot.h"
+
+#include <SFML/System/Sleep.hpp>
+#include <SFML/System/Time.hpp>
+#include <algorithm>
+#include <iostream>
+
+SimulationThread::SimulationThread(World& world, float stepMilliseconds, int maxSubsteps, StepFunction stepFunction)
+    : world(world), timestep(stepMilliseconds, maxSubsteps), stepFunction(std::move(stepFunction))
+{
+    profiler.frameName = "Simulation tick";
+
+    //The render thread has something to draw straight away
+    publish();
+    snapshots.acquire();
+
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+SimulationThread::~SimulationThread()
+{
+    stop();
+}
+
+void SimulationThread::stop()
+{
+    stopping = true;
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+void SimulationThread::send(const SimulationCommand& command)
+{
+    std::lock_guard<std::mutex> lock(commandsMutex);
+    pendingCommands.push_back(command);
+}
+
+const WorldSnapshot& SimulationThread::latestSnapshot()
+{
+    snapshots.acquire();
+    return snapshots.readSlot();
+}
+
+float SimulationThread::alphaNow(const WorldSnapshot& snapshot) const
+{
+    float sincePublished = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - snapshot.publishedAt).count();
+    return std::clamp(snapshot.alpha + sincePublished / timestep.step, 0.f, 1.f);
+}
+
+void SimulationThread::run()
+{
+    setThreadProfiler(&profiler);
+    if (profilerEnabled)
+    {
+        traceBuffer().nameThread("Simulation");
+    }
+
+    auto last = std::chrono::steady_clock::now();
+    while (!stopping)
+    {
+        bool changed = applyCommands();
+
+        auto now = std::chrono::steady_clock::now();
+        float frameTime = std::chrono::duration<float, std::milli>(now - last).count();
+        last = now;
+
+        int steps = paused ? 0 : timestep.advance(frameTime);
+        for (int step = 0; step < steps; ++step)
+        {
+            stepFunction(world);
+        }
+
+        if (steps > 0 || changed)
+        {
+            publish();
+            GAME2_PROFILE_END_FRAME();
+        }
+
+        //Nothing to do until the next step is due. sf::sleep raises the timer resolution on Windows while it waits,
+        //std::this_thread::sleep_for could oversleep by a whole 15.6 ms tick
+        float untilNextStep = paused ? timestep.step : timestep.step - timestep.accumulator;
+        sf::sleep(sf::microseconds(static_cast<std::int64_t>(std::max(untilNextStep, 0.f) * 1000.f)));
+    }
+}
+
+bool SimulationThread::applyCommands()
+{
+    {
+        std::lock_guard<std::mutex> lock(commandsMutex);
+        std::swap(pendingCommands, applyingCommands);
+    }
+
+    for (const SimulationCommand& command : applyingCommands)
+    {
+        if (command.type == SimulationCommand::Type::AddPlanet)
+        {
+            world.addPlanet(command.planet);
+        }
+        else if (command.type == SimulationCommand::Type::SetBounds)
+        {
+            world.setBounds(command.bounds);
+        }
+        else if (command.type == SimulationCommand::Type::SaveSnapshot)
+        {
+            if (saveSnapshot(command.path, world.getPlanets(), world.getSimulationTime(), world.getStepCount()))
+            {
+                std::cout << "Saved " << world.getPlanetCount() << " planets to " << command.path << '\n';
+            }
+            else
+            {
+                std::cerr << "Couldn't write snapshot " << command.path << '\n';
+            }
+        }
+        else if (command.type == SimulationCommand::Type::LoadSnapshot)
+        {
+            SnapshotContents loaded;
+            std::string error;
+            if (loadSnapshot(command.path, loaded, error))
+            {
+                world.loadState(std::move(loaded.planets), loaded.simulationTime, loaded.stepCount);
+                std::cout << "Loaded " << world.getPlanetCount() << " planets from " << command.path << '\n';
+            }
+            else
+            {
+                std::cerr << "Couldn't load snapshot " << command.path << ": " << error << '\n';
+            }
+        }
+    }
+
+    bool changed = !applyingCommands.empty();
+    applyingCommands.clear();
+    return changed;
+}
+
+void SimulationThread::publish()
+{
+    //assign keeps the slot's capacity, so this only allocates when the planet count grows
+    WorldSnapshot& snapshot = snapshots.writeSlot();
+    const std::vector<RenderPlanet>& renderPlanets = world.getRenderPlanets();
+    snapshot.planets.assign(renderPlanets.begin(), renderPlanets.end());
+    snapshot.stepCount = world.getStepCount();
+    snapshot.alpha = timestep.alpha();
+    snapshot.publishedAt = std::chrono::steady_clock::now();
+    snapshots.publish();
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FixedTimestep.h"
+#include "Profiler.h"
+#include "TripleBuffer.h"
+#include "World.h"
+
+//What the render thread gets to see of the world, published after every batch of steps
+struct WorldSnapshot
+{
+    std::vector<RenderPlanet> planets;
+    long long stepCount = 0;
+    float alpha = 0.f; //FixedTimestep alpha when it was published, how far past the last step the simulation clock was
+    std::chrono::steady_clock::time_point publishedAt;
+};
+
+//Changes the render thread asks for, applied by the simulation thread before its next step
+struct SimulationCommand
+{
+    enum class Type
+    {
+        AddPlanet,
+        SetBounds,
+        SaveSnapshot, //Written between two steps, so the file never has half a step in it
+        LoadSnapshot  //Replaces every planet, a file that can't be read leaves the world as it was
+    };
+
+    Type type;
+    Planet planet; //AddPlanet
+    Vector2d bounds; //SetBounds
+    std::string path; //SaveSnapshot and LoadSnapshot
+
+public:
+    //One for each type, so every member is always set and new ones only have to be added here
+    static SimulationCommand addPlanet(const Planet& planet) { return { Type::AddPlanet, planet, {}, {} }; }
+    static SimulationCommand setBounds(Vector2d bounds) { return { Type::SetBounds, Planet{}, bounds, {} }; }
+    static SimulationCommand saveSnapshot(const std::string& path) { return { Type::SaveSnapshot, Planet{}, {}, path }; }
+    static SimulationCommand loadSnapshot(const std::string& path) { return { Type::LoadSnapshot, Planet{}, {}, path }; }
+};
+
+//Steps the World on its own thread in real time, so a slow force pass doesn't drop frames and waiting for vsync doesn't
+//hold up physics. The render thread only ever reads the latest snapshot, handed over through a lock free triple buffer.
+//Once started the World belongs to this thread, everything else goes through send().
+struct SimulationThread
+{
+    //Runs one physics step of stepMilliseconds
+    using StepFunction = std::function<void(World&)>;
+
+public:
+    SimulationThread(World& world, float stepMilliseconds, int maxSubsteps, StepFunction stepFunction);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    //Waits for the current batch of steps to finish, the World can be used directly again afterwards
+    void stop();
+
+    void send(const SimulationCommand& command);
+
+    //Paused time isn't simulated, it doesn't pile up to be caught up on later
+    void setPaused(bool paused) { this->paused = paused; }
+
+    //Render thread only: the newest snapshot, stays unchanged until the next call
+    const WorldSnapshot& latestSnapshot();
+
+    //How far between the snapshot's last two steps to draw now. Carries on from the published alpha in real time,
+    //so drawing stays smooth when the two threads run at different rates
+    float alphaNow(const WorldSnapshot& snapshot) const;
+
+    FrameProfiler& getProfiler() { return profiler; }
+
+private:
+    void run();
+    bool applyCommands(); //Returns true if anything changed
+    void publish();
+
+    World& world;
+    FixedTimestep timestep;
+    StepFunction stepFunction;
+    FrameProfiler profiler; //One "frame" is one batch of steps
+
+    TripleBuffer<WorldSnapshot> snapshots;
+
+    std::mutex commandsMutex; //Commands are rare (clicks, resizes), only the snapshots need to be lock free
+    std::vector<SimulationCommand> pendingCommands;
+    std::vector<SimulationCommand> applyingCommands; //Swapped with pendingCommands so the lock is only held for the swap
+
+    std::atomic<bool> paused{ false };
+    std::atomic<bool> stopping{ false };
+    std::thread thread; //Last, so everything above is set up before it starts
+};
@@ -1,26 +1,24 @@
 #include <SFML/Graphics.hpp>
 #include <iostream>
 #include <SFML/OpenGL.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <math.h>
+#include <string>
 #include <vector>
-
-//Stores information about planets, used for gravity calculations and movement.
-struct Planet
-{
-    sf::Vector2f position;
-    double radius;
-    double mass; //MASS IN KG
-    sf::Vector2f velocity;
-    sf::Color color = sf::Color(rand() % 256, rand() % 256, rand() % 256);
-};
-
-//Function that divides a vector by a scalars
-sf::Vector2f divideVectorByDouble(sf::Vector2f v1, double scalar) {
-
-    return sf::Vector2f(v1.x / scalar, v1.y / scalar);
-}
-
-
+#include "World.h"
+#include "AllocationCounter.h"
+#include "Scenarios.h"
+#include "Snapshot.h"
+#include "PlanetRenderer.h"
+#include "SimulationThread.h"
+#include "Input.h"
+#include "Profiler.h"
+#include "ProfilerOverlay.h"
+
+//Pause menu, drawn over the planets as part of the normal frame while isOpen is set
 struct Menu {
 
     sf::RectangleShape backGround;
@@ -28,6 +26,7 @@ struct Menu {
     sf::Font menuFont;
     float windowLength;
     float windowHeight;
+    bool isOpen = false;
 
 public:
     Menu() 
@@ -52,7 +51,11 @@ public:
         window.draw(closeMenuButton);
     }
 
+    //Only needs calling when the window size changes
     void updateLayout(float windowLength, float windowHeight) {
+        this->windowLength = windowLength;
+        this->windowHeight = windowHeight;
+
         sf::Vector2f size(windowLength / 2.0f, windowHeight / 2.0f);
         backGround.setSize(size);
         backGround.setOrigin(size/2.0f);
@@ -72,7 +75,41 @@ public:
 
 };
 
-long double G = 6.6743e-11;
+//Debug builds check that a frame with no new planets doesn't touch the heap, and say so on stderr if it does
+struct FrameAllocationCheck
+{
+    static constexpr long long warmupFrames = 60; //Buffers settle into their sizes over the first frames
+    static constexpr long long quietFrames = 60;  //At most one warning this often, so a leak doesn't flood the console
+
+    long long frame = 0;
+    long long nextWarning = 0;
+    std::uint64_t allocationsAtStart = 0;
+    std::size_t planetsAtStart = 0;
+
+public:
+    void startFrame(std::size_t planetCount)
+    {
+        ++frame;
+        allocationsAtStart = heapAllocationCount();
+        planetsAtStart = planetCount;
+    }
+
+    //Only planets being added are allowed to grow buffers
+    void check(std::size_t planetCount)
+    {
+        if (!allocationCounterEnabled || frame <= warmupFrames || planetCount != planetsAtStart)
+        {
+            return;
+        }
+
+        std::uint64_t made = heapAllocationCount() - allocationsAtStart;
+        if (made > 0 && frame >= nextWarning)
+        {
+            std::cerr << "Frame " << frame << " made " << made << " heap allocations" << std::endl;
+            nextWarning = frame + quietFrames;
+        }
+    }
+};
 
 sf::Vector2u getDesktopResolution(int& horizontal, int& vertical) {
     RECT desktop;
@@ -87,106 +124,419 @@ sf::Vector2u getDesktopResolution(int& horizontal, int& vertical) {
 
 }
 
-//Calculates the gravitational force between 2 planets. Used to figure out planet accelerations / movement
-long double calculateGravityForce(double mass1, double mass2, double distance)
+//Options picked at startup from the command line
+struct SimulationSettings
 {
-        //Force = (G * mass1 * mass2) / distance^2 
-        //DISTANCE BEING BETWEEN PLANET CENTERS IN METERS
+    WorldSettings world;
+
+    //Headless mode runs the physics with no window, for timing on machines without a screen
+    bool headless = false;
+    int steps = 1000;               //Physics steps to run
+    int bodies = 2000;              //Planets to generate if no file is loaded
+    unsigned seed = 1;              //Seed for the generated planets, same seed gives the same run
+    bool useScenario = false;       //Generate one of the benchmark scenarios instead of scattering planets at rest
+    Scenario scenario = Scenario::UniformDisk;
+    std::string loadPath;           //Snapshot, or a text file with one "x y vx vy mass radius" planet per line
+    std::string snapshotPath = "snapshot.g2s"; //Saved on F5 and loaded on F9
+    std::string savePath;           //Headless only: snapshot written after the last step, empty doesn't save
+    sf::Vector2f worldSize = { 1920.f, 1080.f }; //Stands in for the window size (pixels) the planets bounce off
+    float deltaTime = 16.f;         //Milliseconds per physics step, the window's simulation thread runs them in real time
+    int maxSubsteps = 8;            //Most physics steps the simulation thread runs in one go before it lets the simulation fall behind
+    bool runInMenu = false;         //Keep simulating behind the pause menu instead of pausing
+
+    std::string diagnosticsPath;    //CSV file for energy and momentum, empty turns diagnostics off
+    long long diagnosticsInterval = 100; //Steps between diagnostics rows
+
+    std::string tracePath = "trace.json"; //Chrome trace of the last few seconds, written on F4
+    bool traceOnExit = false;       //Also write it when the program ends, set by --trace
+};
+
+//Reads startup options, e.g. Game2.exe --solver barnes-hut --theta 0.7 --threads 4
+//or Game2.exe --headless --bodies 5000 --steps 200
+SimulationSettings parseCommandLine(int argc, char* argv[])
+{
+    SimulationSettings settings;
 
-    long double force = (G * mass1 * mass2) / (distance * distance);
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
 
-    return force;
+        if (arg == "--solver" && hasValue)
+        {
+            std::string value = argv[++i];
+            if (value == "direct") settings.world.solver = GravitySolver::DirectSum;
+            else if (value == "barnes-hut") settings.world.solver = GravitySolver::BarnesHut;
+            else if (value == "pm") settings.world.solver = GravitySolver::ParticleMesh;
+            else if (value == "fmm") settings.world.solver = GravitySolver::FastMultipole;
+            else std::cerr << "Unknown solver '" << value << "', using direct" << std::endl;
+        }
+        else if (arg == "--theta" && hasValue)
+        {
+            settings.world.theta = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (arg == "--pm-grid" && hasValue)
+        {
+            settings.world.meshSize = static_cast<std::size_t>(std::max(16, std::atoi(argv[++i])));
+        }
+        else if (arg == "--fmm-order" && hasValue)
+        {
+            settings.world.multipoleOrder = std::clamp(std::atoi(argv[++i]), 1, FastMultipoleTree::maxOrder);
+        }
+        else if (arg == "--integrator" && hasValue)
+        {
+            std::string value = argv[++i];
+            if (value == "euler") settings.world.integrator = Integrator::Euler;
+            else if (value == "leapfrog") settings.world.integrator = Integrator::Leapfrog;
+            else if (value == "yoshida") settings.world.integrator = Integrator::Yoshida;
+            else if (value == "block") settings.world.integrator = Integrator::Block;
+            else std::cerr << "Unknown integrator '" << value << "', using euler" << std::endl;
+        }
+        else if (arg == "--block-levels" && hasValue)
+        {
+            settings.world.maxTimestepLevel = std::clamp(std::atoi(argv[++i]), 0, 30);
+        }
+        else if (arg == "--block-accuracy" && hasValue)
+        {
+            settings.world.timestepAccuracy = std::max(1.0e-6, std::atof(argv[++i]));
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            settings.world.threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (arg == "--kernel" && hasValue)
+        {
+            std::string value = argv[++i];
+            GravityKernel requested = settings.world.kernel;
+            if (value == "scalar") requested = GravityKernel::Scalar;
+            else if (value == "sse") requested = GravityKernel::Sse;
+            else if (value == "avx2") requested = GravityKernel::Avx2;
+            else std::cerr << "Unknown kernel '" << value << "'" << std::endl;
+
+            if (isGravityKernelSupported(requested)) settings.world.kernel = requested;
+            else std::cerr << "This CPU doesn't support " << value << ", using " << gravityKernelName(settings.world.kernel) << std::endl;
+        }
+        else if (arg == "--headless")
+        {
+            settings.headless = true;
+        }
+        else if (arg == "--steps" && hasValue)
+        {
+            settings.steps = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--bodies" && hasValue)
+        {
+            settings.bodies = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--seed" && hasValue)
+        {
+            settings.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--scenario" && hasValue)
+        {
+            std::string value = argv[++i];
+            settings.useScenario = parseScenario(value, settings.scenario);
+            if (!settings.useScenario) std::cerr << "Unknown scenario '" << value << "', scattering planets instead" << std::endl;
+        }
+        else if (arg == "--load" && hasValue)
+        {
+            settings.loadPath = argv[++i];
+        }
+        else if (arg == "--snapshot" && hasValue)
+        {
+            settings.snapshotPath = argv[++i];
+        }
+        else if (arg == "--save" && hasValue)
+        {
+            settings.savePath = argv[++i];
+        }
+        else if (arg == "--size" && i + 2 < argc)
+        {
+            settings.worldSize.x = static_cast<float>(std::atof(argv[++i]));
+            settings.worldSize.y = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--dt" && hasValue)
+        {
+            settings.deltaTime = std::max(0.001f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--diagnostics" && hasValue)
+        {
+            settings.diagnosticsPath = argv[++i];
+        }
+        else if (arg == "--diagnostics-interval" && hasValue)
+        {
+            settings.diagnosticsInterval = std::max(1LL, std::atoll(argv[++i]));
+        }
+        else if (arg == "--run-in-menu")
+        {
+            settings.runInMenu = true;
+        }
+        else if (arg == "--collisions" && hasValue)
+        {
+            std::string value = argv[++i];
+            if (value == "bounce") settings.world.collisionMode = CollisionMode::Bounce;
+            else if (value == "merge") settings.world.collisionMode = CollisionMode::Merge;
+            else std::cerr << "Unknown collision mode '" << value << "', using bounce" << std::endl;
+        }
+        else if (arg == "--sleep")
+        {
+            settings.world.sleeping = true;
+        }
+        else if (arg == "--sleep-energy" && hasValue)
+        {
+            settings.world.sleep.energyThreshold = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (arg == "--softening" && hasValue)
+        {
+            settings.world.softening = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (arg == "--trace" && hasValue)
+        {
+            settings.tracePath = argv[++i];
+            settings.traceOnExit = true;
+        }
+        else if (arg == "--max-substeps" && hasValue)
+        {
+            settings.maxSubsteps = std::max(1, std::atoi(argv[++i]));
+        }
+        else
+        {
+            std::cerr << "Ignoring unknown argument '" << arg << "'" << std::endl;
+        }
+    }
+
+    return settings;
 }
 
-//Function to get the vector between 2 planets
-sf::Vector2f vectorFromPlanets(Planet planet1, Planet planet2)
+//Reads planets from a text file, one "x y vx vy mass radius" per line in meters, m/s and kg. Returns false if the file can't be opened
+bool loadPlanetsFromText(const std::string& path, World& world)
 {
-    return planet2.position - planet1.position;
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    Planet planet;
+    while (file >> planet.position.x >> planet.position.y >> planet.velocity.x >> planet.velocity.y >> planet.mass >> planet.radius)
+    {
+        world.addPlanet(planet);
+    }
+    return true;
 }
 
-sf::Vector2f getVectorFromForce(double mass, long double force, sf::Vector2f direction)
+//Loads a snapshot or, for anything that doesn't start like one, the text format. Prints why if it can't
+bool loadPlanets(const std::string& path, World& world)
 {
-    sf::Vector2f newVector;
-    double magnitude = (force / mass);
-    return direction * static_cast<float>(magnitude);
-}
+    if (!isSnapshotFile(path))
+    {
+        if (!loadPlanetsFromText(path, world))
+        {
+            std::cerr << "Couldn't open " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
 
-//Dot product funct9on
-inline float dot(const sf::Vector2f& a, const sf::Vector2f& b) { return a.x * b.x + a.y * b.y; }
+    auto start = std::chrono::steady_clock::now();
+    SnapshotContents loaded;
+    std::string error;
+    if (!loadSnapshot(path, loaded, error))
+    {
+        std::cerr << "Couldn't load snapshot " << path << ": " << error << std::endl;
+        return false;
+    }
+    world.loadState(std::move(loaded.planets), loaded.simulationTime, loaded.stepCount);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Loaded " << world.getPlanetCount() << " planets from " << path << " in " << milliseconds << " ms" << std::endl;
+    return true;
+}
 
-inline float len(const sf::Vector2f& v) { return std::sqrt(dot(v, v)); }
+//Particle-mesh loses everything closer than about a cell, say so if the softening doesn't already smooth that out.
+//Uses the planets' spread, or the whole world before any are placed
+void warnIfMeshTooCoarse(const SimulationSettings& settings, const World& world)
+{
+    if (settings.world.solver != GravitySolver::ParticleMesh)
+    {
+        return;
+    }
 
-//Function that multiplies 2 vectors together
-template <typename T>
-sf::Vector2<T> multiplyVectors(sf::Vector2<T> v1, sf::Vector2<T> v2) {
+    Vector2d bounds = world.getBounds();
+    double extent = std::max(bounds.x, bounds.y);
+    const std::vector<Planet>& planets = world.getPlanets();
+    if (!planets.empty())
+    {
+        auto [minX, maxX] = std::minmax_element(planets.begin(), planets.end(), [](const Planet& a, const Planet& b) { return a.position.x < b.position.x; });
+        auto [minY, maxY] = std::minmax_element(planets.begin(), planets.end(), [](const Planet& a, const Planet& b) { return a.position.y < b.position.y; });
+        extent = std::max(maxX->position.x - minX->position.x, maxY->position.y - minY->position.y);
+    }
 
-    return sf::Vector2<T>(v1.x * v2.x, v1.y * v2.y);
+    double cellSize = ParticleMesh::cellSizeFor(extent, settings.world.meshSize);
+    if (settings.world.softening < cellSize)
+    {
+        std::cerr << "Particle-mesh cells are " << cellSize << " m across, wider than the " << settings.world.softening
+            << " m softening, so close forces will be well off. Use --softening " << cellSize << " or more, or a bigger --pm-grid" << std::endl;
+    }
 }
 
-//Function that multiplies a vector by a scalar
-sf::Vector2f multiplyVectorByDouble(sf::Vector2f v1, double scalar) {
+//Scatters planets at rest over the whole world, seeded so runs can be compared
+void generatePlanets(int count, unsigned seed, World& world)
+{
+    srand(seed);
 
-    return sf::Vector2f(v1.x * scalar, v1.y * scalar);
+    Vector2d bounds = world.getBounds();
+    for (int i = 0; i < count; ++i)
+    {
+        double x = bounds.x * (rand() / static_cast<double>(RAND_MAX));
+        double y = bounds.y * (rand() / static_cast<double>(RAND_MAX));
+        world.addPlanet(Planet{ { x, y }, 0.05, 1.0e10, Vector2d(0,0) }); //10 pixels across at zoom 1
+    }
 }
 
-//Function to calculate planet velocity after a collision with another planet
-void doPlanetPlanetCollision(Planet& p1, Planet& p2, float restitution = 0.8f)
+//Opens the diagnostics CSV if one was asked for and records the starting state as the first row
+void openDiagnostics(const SimulationSettings& settings, World& world, DiagnosticsLog& diagnostics)
 {
-    float minimumDistance = p1.radius + p2.radius;
-    float distBetweenPlanetCenters = std::sqrt((p2.position.x-p1.position.x)*(p2.position.x-p1.position.x) + (p2.position.y-p1.position.y)*(p2.position.y-p1.position.y));
-
-    if (minimumDistance >= distBetweenPlanetCenters) {
-        sf::Vector2f norm = (p2.position - p1.position) / distBetweenPlanetCenters;
-        float pValue = (2 * (p1.velocity.x * norm.x + p1.velocity.y * norm.y - p2.velocity.x * norm.x - p2.velocity.y * norm.y))/(p1.mass+p2.mass);
-
-        p1.velocity = (p1.velocity - multiplyVectorByDouble(norm, pValue * p1.mass)) * restitution;
-        p2.velocity = (p2.velocity + multiplyVectorByDouble(norm, pValue * p2.mass)) * restitution;
+    if (settings.diagnosticsPath.empty())
+    {
+        return;
     }
-    else {
+
+    if (!diagnostics.open(settings.diagnosticsPath, settings.diagnosticsInterval))
+    {
+        std::cerr << "Couldn't create " << settings.diagnosticsPath << ", diagnostics are off" << std::endl;
         return;
     }
+    diagnostics.record(world.getStepCount(), world.getSimulationTime(), world.measureEnergyMomentum());
 }
 
+//Steps the world once (deltaTime in milliseconds) and writes a diagnostics row if one is due
+void stepWorld(World& world, float deltaTime, DiagnosticsLog& diagnostics)
+{
+    world.step(deltaTime / 1000.0);
+    if (diagnostics.isDue(world.getStepCount()))
+    {
+        GAME2_PROFILE_SCOPE(ProfilePhase::Diagnostics);
+        diagnostics.record(world.getStepCount(), world.getSimulationTime(), world.measureEnergyMomentum());
+    }
+}
 
-//Function to prevent 2 planets from slowly sinking into each other once they are resting against each other
-void preventSinking(Planet& p1, Planet& p2)
+//Writes the recorded phase timings for chrome://tracing or ui.perfetto.dev
+void writeTrace(const std::string& path)
 {
-    const float minDist = p1.radius + p2.radius;
-    sf::Vector2f d = p2.position - p1.position;
-    float dist = len(d);
-    if (dist >= minDist || dist == 0.f) return;
-
-    sf::Vector2f n = d / dist; // contact normal
-    float penetration = minDist - dist;
-
-    // Move each planet out along the normal, weighted by mass
-    float invA = (p1.mass > 0.f) ? 1.f / p1.mass : 0.f;
-    float invB = (p2.mass > 0.f) ? 1.f / p2.mass : 0.f;
-
-    const float slop = 0.01f; // ignore tiny overlap to avoid jitter
-    const float percent = 0.8f; // 1.0 is push fully out (set 0.8 for softer)
-    float corrMag = std::max(penetration - slop, 0.f) / (invA + invB) * percent;
-
-    sf::Vector2f correction = corrMag * n;
-    p1.position -= invA * correction;
-    p2.position += invB * correction;
-
-    // (optional) kill closing motion along the normal to keep them resting
-    sf::Vector2f rv = p2.velocity - p1.velocity;
-    float vn = rv.x * n.x + rv.y * n.y;
-    if (vn < 0.f) {
-        sf::Vector2f vnVec = vn * n;
-        p1.velocity += invA * vnVec;
-        p2.velocity -= invB * vnVec;
+    if (!profilerEnabled)
+    {
+        std::cerr << "The profiler is compiled out (GAME2_DISABLE_PROFILER), there is no trace to write" << std::endl;
+    }
+    else if (traceBuffer().writeJson(path))
+    {
+        std::cout << "Wrote trace to " << path << std::endl;
+    }
+    else
+    {
+        std::cerr << "Couldn't create " << path << std::endl;
     }
 }
 
-constexpr double softening2 = 1e6;         // (meters^2) tune per your scale
-constexpr double pixels_per_meter = 1.0 / 1e6;
-inline double metersPerPixel() { return 1.0 / pixels_per_meter; }
+//Runs a fixed number of physics steps with no window and prints how long they took
+int runHeadless(const SimulationSettings& settings)
+{
+    World world(settings.world);
+    world.setBounds(Vector2d(settings.worldSize) * metersPerPixel());
+
+    if (!settings.loadPath.empty())
+    {
+        if (!loadPlanets(settings.loadPath, world))
+        {
+            return 1;
+        }
+    }
+    else if (settings.useScenario)
+    {
+        for (const Planet& planet : generateScenario(settings.scenario, settings.bodies, settings.seed, world.getBounds() / 2.0))
+        {
+            world.addPlanet(planet);
+        }
+    }
+    else
+    {
+        generatePlanets(settings.bodies, settings.seed, world);
+    }
+
+    warnIfMeshTooCoarse(settings, world);
+    DiagnosticsLog diagnostics;
+    openDiagnostics(settings, world, diagnostics);
+
+    std::cout << "Headless: " << world.getPlanetCount() << " planets, " << settings.steps << " steps, solver "
+        << gravitySolverName(settings.world.solver) << ", kernel " << gravityKernelName(settings.world.kernel)
+        << ", integrator " << integratorName(settings.world.integrator)
+        << ", collisions " << collisionModeName(settings.world.collisionMode)
+        << ", " << world.getThreadCount() << " threads" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    std::uint64_t allocationsAfterFirstStep = 0;
+    //Counted as n(n-1)/2 pairs per step whatever the solver, so solvers can be compared on the same scale.
+    //n is taken before each step, merging can leave far fewer planets at the end than there were for most of the run
+    double pairs = 0.0;
+    for (int step = 0; step < settings.steps; ++step)
+    {
+        double n = static_cast<double>(world.getPlanetCount());
+        pairs += n * (n - 1.0) / 2.0;
+        stepWorld(world, settings.deltaTime, diagnostics);
+        if (step == 0)
+        {
+            allocationsAfterFirstStep = heapAllocationCount();
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (settings.world.collisionMode == CollisionMode::Merge)
+    {
+        std::cout << "Planets left after merging: " << world.getPlanetCount() << std::endl;
+    }
+    else if (settings.world.sleeping)
+    {
+        std::cout << "Planets asleep at the end: " << ContactIslands::countAsleep(world.getPlanets()) << std::endl;
+    }
+    std::cout << "Wall time: " << seconds << " s" << std::endl;
+    std::cout << "Steps/sec: " << settings.steps / seconds << std::endl;
+    std::cout << "Pair interactions/sec: " << pairs / seconds << std::endl;
+    //n per step for the single step integrators (more for Yoshida), block steps should come in well under that
+    std::cout << "Force evaluations/step: " << static_cast<double>(world.getForceEvaluations()) / settings.steps << std::endl;
+    if (allocationCounterEnabled)
+    {
+        //The first step sizes every buffer, after that only busier steps (more collision pairs, deeper trees) should allocate
+        std::cout << "Heap allocations after the first step: " << heapAllocationCount() - allocationsAfterFirstStep << std::endl;
+    }
+
+    if (!settings.savePath.empty())
+    {
+        if (!saveSnapshot(settings.savePath, world.getPlanets(), world.getSimulationTime(), world.getStepCount()))
+        {
+            std::cerr << "Couldn't write snapshot " << settings.savePath << std::endl;
+            return 1;
+        }
+        std::cout << "Saved " << world.getPlanetCount() << " planets to " << settings.savePath << std::endl;
+    }
+
+    if (settings.traceOnExit)
+    {
+        writeTrace(settings.tracePath);
+    }
+    return 0;
+}
 
-int main()
+int main(int argc, char* argv[])
 {
+    SimulationSettings simulationSettings = parseCommandLine(argc, argv);
+    if (profilerEnabled)
+    {
+        traceBuffer().nameThread("Main");
+    }
+
+    if (simulationSettings.headless)
+    {
+        return runHeadless(simulationSettings);
+    }
    
     sf::ContextSettings settings;
     settings.antiAliasingLevel = 4;
@@ -228,29 +578,67 @@ int main()
     window.setVerticalSyncEnabled(true);
     window.setKeyRepeatEnabled(false);
 
-    std::vector<Planet> planets;
+    World world(simulationSettings.world);
+
+    //Planets are drawn and clicked through worldView (meters), the menu through screenView (pixels)
+    const float metersPerScreenPixel = static_cast<float>(metersPerPixel());
+    sf::Vector2f windowSize(window.getSize());
+    sf::View screenView(sf::FloatRect({ 0.f, 0.f }, windowSize));
+    sf::View worldView(sf::FloatRect({ 0.f, 0.f }, windowSize * metersPerScreenPixel));
+    float worldZoom = 1.f; //Meters per pixel compared to zoom 1, bigger shows more of the world
+    world.setBounds(Vector2d(windowSize) * metersPerPixel());
+    if (!simulationSettings.loadPath.empty())
+    {
+        //Starts empty if it can't be read, the same as with no file
+        loadPlanets(simulationSettings.loadPath, world);
+    }
+    warnIfMeshTooCoarse(simulationSettings, world);
+
+    DiagnosticsLog diagnostics;
+    openDiagnostics(simulationSettings, world, diagnostics);
 
-    sf::Clock clock; // for delta time
+    //From here on the world is stepped on its own thread, changes to it go through simulation.send()
+    SimulationThread simulation(world, simulationSettings.deltaTime, simulationSettings.maxSubsteps, [&](World& steppedWorld)
+    {
+        stepWorld(steppedWorld, simulationSettings.deltaTime, diagnostics);
+    });
 
     sf::Texture planetTexture;
     planetTexture.loadFromFile("Assets/rusts.jpg");
     planetTexture.setSmooth(true);
 
     Menu settingsMenu;
-
-    //Main game loop
+    settingsMenu.updateLayout(screenResolution.x * horizontalScale, screenResolution.y * horizontalScale);
+    PlanetRenderer planetRenderer;
+    InputQueue input;
+    ProfilerOverlay profilerOverlay;
+    FrameAllocationCheck allocationCheck;
+    std::size_t drawnPlanets = 0;
+
+    //Main game loop, drawing only. The simulation runs at its own rate and this draws whatever it published last
     while (window.isOpen())
     {
+        allocationCheck.startFrame(drawnPlanets);
 
-        //Constantly gets mouse position in the window
-        sf::Vector2i localPosition = sf::Mouse::getPosition(window);
+        //Everything from polling events to acting on them counts as Events
+        {
+            GAME2_PROFILE_SCOPE(ProfilePhase::Events);
 
-        // --- DELTA TIME ---
-        float deltaTime;
+            //While an event is happening
+            while (const std::optional event = window.pollEvent())
+            {
+                input.handleEvent(*event);
 
-        //While an event is happening
-        while (const std::optional event = window.pollEvent())
-        {
+                // window resize, however does not scale objects
+                if (const auto* resized = event->getIf<sf::Event::Resized>())
+                {
+                    windowSize = sf::Vector2f(resized->size);
+                    screenView = sf::View(sf::FloatRect({ 0.f, 0.f }, windowSize));
+                    worldView.setSize(windowSize * metersPerScreenPixel * worldZoom);
+                    simulation.send(SimulationCommand::setBounds(Vector2d(windowSize) * metersPerPixel()));
+                    settingsMenu.updateLayout(resized->size.x * horizontalScale, resized->size.y * horizontalScale);
+                }
+            }
 
             //=================================================//
             //    .___  ___.  _______ .__   __.  __    __      //
@@ -261,197 +649,95 @@ int main()
             //    |__|  |__| |_______||__| \__|  \______/      //
             //=================================================//  
 
-            //This is some TERRIBLE TERRIBLE logic, pls find way to clean later. PLEASE
-                                                                                                                                         
-            bool menu = false;
-
-            //If the event is the left mouse button
-            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Escape))
+            for (const InputAction& action : input.actions)
             {
-
-                bool pressed = true;
-                while (pressed)
+                //If the event is clicking on the X then the window closes
+                if (action.type == InputActionType::Quit)
                 {
-                    if (!(sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Escape)))
-                    {
-                        pressed = false;
-                    }
+                    window.close();
                 }
-
-                if (menu == false) {
-                    menu = true;
+                else if (action.type == InputActionType::ToggleMenu)
+                {
+                    settingsMenu.isOpen = !settingsMenu.isOpen;
                 }
-            }
-
-            while (menu == true) {
-                deltaTime = 0;
-                std::cout << "Menu open" << std::endl;
-
-                if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Escape))
+                else if (action.type == InputActionType::ToggleProfiler)
                 {
-                    //Logic so menu isnt spammed
-                    bool pressed = true;
-                    while (pressed)
-                    {
-                        if (!(sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Escape)))
-                        {
-                            pressed = false;
-                        }
-                    }
-
-                    if (menu == true) {
-                        menu = false;
-                    }
+                    profilerOverlay.isOpen = !profilerOverlay.isOpen;
                 }
-
-                float scaledLength = screenResolution.x * horizontalScale;
-                float scaledHeight = screenResolution.y * horizontalScale;
-
-                settingsMenu.windowLength = scaledLength;
-                settingsMenu.windowHeight = scaledHeight;
-
-
-                settingsMenu.updateLayout(scaledLength, scaledHeight);
-
-                settingsMenu.draw(window);
-                window.display();
-
-                if (settingsMenu.closeMenuButton.getGlobalBounds().contains(static_cast<sf::Vector2f>(sf::Mouse::getPosition()))) {
-                    menu = false;
+                else if (action.type == InputActionType::WriteTrace)
+                {
+                    writeTrace(simulationSettings.tracePath);
                 }
-
-
-
-
-
-            }
-
-            //=======================================================================
-
-            deltaTime = clock.restart().asMilliseconds(); // seconds since last frame
-
-            //If the event is clicking on the X or Escape then the window closes
-            if (event->is<sf::Event::Closed>())
-            {
-                window.close();
-            }
-
-            if (sf::Mouse::isButtonPressed(sf::Mouse::Button::Right)) {
-                bool moving = true;
-
-            }
-
-            //If the event is the left mouse button
-            if (sf::Mouse::isButtonPressed(sf::Mouse::Button::Left))
-            {
-                //Some logic so that the mouse input isn't spammed, planet only placed on RELEASE of mouse button
-                bool pressed = true;
-                while (pressed)
+                else if (action.type == InputActionType::SaveSnapshot)
+                {
+                    simulation.send(SimulationCommand::saveSnapshot(simulationSettings.snapshotPath));
+                }
+                else if (action.type == InputActionType::LoadSnapshot)
+                {
+                    simulation.send(SimulationCommand::loadSnapshot(simulationSettings.snapshotPath));
+                }
+                else if (action.type == InputActionType::Click && settingsMenu.isOpen)
                 {
-                    if (!(sf::Mouse::isButtonPressed(sf::Mouse::Button::Left)))
+                    //Clicks go to the menu while it's open, the close button is the only thing on it so far
+                    if (settingsMenu.closeMenuButton.getGlobalBounds().contains(window.mapPixelToCoords(action.pixel, screenView)))
                     {
-                        pressed = false;
+                        settingsMenu.isOpen = false;
                     }
                 }
-                sf::Vector2i pixel = sf::Mouse::getPosition(window);
-                // left mouse button is pressed: Place circle (Add the planet into an array with other planets which are then drawn later)
-                planets.push_back(Planet{ static_cast<sf::Vector2f>(pixel), 50.f, 1.0e10, sf::Vector2f(0,0) });
-               
-            } 
-
-            // window resize, however does not scale objects
-            if (const auto* resized = event->getIf<sf::Event::Resized>())
-            {
-                sf::FloatRect visibleArea({ 0.f, 0.f }, sf::Vector2f(resized->size));
-                window.setView(sf::View(visibleArea));
-            }
-        }
-
-        //Planet accelerations stored and used later to update planet positions
-        std::vector<sf::Vector2f> planetAccelerations(planets.size(), { 0.f, 0.f });
-
-        deltaTime = clock.restart().asMilliseconds(); // seconds since last frame
-        // Math to calculate acceleration between planet. This is calculated from each planet to all other planets.
-        for (std::size_t x = 0; x < planets.size(); ++x)
-        {
-            for (std::size_t y = x + 1; y < planets.size(); ++y)
-            {
-                sf::Vector2f r = vectorFromPlanets(planets[x], planets[y]);
-                double distance = std::sqrt(r.x * r.x + r.y * r.y); 
-                if (distance == 0.f)
+                else if (action.type == InputActionType::Click)
                 {
-                    continue;
+                    // left mouse button released: Place circle (Add the planet into an array with other planets which are then drawn later)
+                    Planet planet{ Vector2d(window.mapPixelToCoords(action.pixel, worldView)), 0.5, 1.0e10, Vector2d(0,0) };
+                    simulation.send(SimulationCommand::addPlanet(planet));
+                }
+                else if (action.type == InputActionType::Zoom)
+                {
+                    //Zoom about the mouse, so the point under it stays put
+                    float factor = pow(0.9f, action.wheelDelta);
+                    sf::Vector2f before = window.mapPixelToCoords(action.pixel, worldView);
+                    worldView.zoom(factor);
+                    worldZoom *= factor;
+                    worldView.move(before - window.mapPixelToCoords(action.pixel, worldView));
                 }
-
-                long double force = calculateGravityForce(planets[x].mass, planets[y].mass, distance);
-
-                sf::Vector2f unitVector = { r.x / static_cast<float>(distance), r.y/static_cast<float>(distance) };
-
-                sf::Vector2f accelerationOnX = getVectorFromForce(planets[x].mass, force, unitVector);
-                sf::Vector2f accelerationOnY = getVectorFromForce(planets[y].mass, force, -unitVector);
-
-                planetAccelerations[x] += accelerationOnX;
-                planetAccelerations[y] += accelerationOnY;
-
-                //std::cout << "Force: " << force << std::endl;  
             }
+            input.clear();
         }
 
-        //----------------------------------------EDGE OF WINDOW COLLISION LOOP------------------------------------
-        for (std::size_t i = 0; i < planets.size(); ++i)
+        //Time spent in the menu isn't simulated unless asked for
+        simulation.setPaused(settingsMenu.isOpen && !simulationSettings.runInMenu);
+
         {
-            if ((window.getSize().x < (planets[i].position.x + planets[i].radius)))
-            {
-                planets[i].position.x = window.getSize().x - planets[i].radius;
-                planets[i].velocity.x = -planets[i].velocity.x;
-            }
-            if (((planets[i].position.x - planets[i].radius) < 0))
-            {
-                planets[i].position.x = planets[i].radius;
-                planets[i].velocity.x = -planets[i].velocity.x;
-            }
+            GAME2_PROFILE_SCOPE(ProfilePhase::Draw);
+            window.clear(sf::Color::Black);
 
-            if ((window.getSize().y < (planets[i].position.y + planets[i].radius)))
-            {
-                planets[i].position.y = window.getSize().y - planets[i].radius;
-                planets[i].velocity.y = -planets[i].velocity.y;
-            }
+            //Draw all the planets in one go
+            const WorldSnapshot& snapshot = simulation.latestSnapshot();
+            drawnPlanets = snapshot.planets.size();
+            window.setView(worldView);
+            planetRenderer.draw(window, snapshot.planets, simulation.alphaNow(snapshot));
 
-            if (((planets[i].position.y - planets[i].radius) < 0))
+            window.setView(screenView);
+            if (settingsMenu.isOpen)
             {
-                planets[i].position.y = planets[i].radius;
-                planets[i].velocity.y = -planets[i].velocity.y;
+                settingsMenu.draw(window);
             }
-            planets[i].velocity += planetAccelerations[i] * deltaTime;
-            planets[i].position += planets[i].velocity * deltaTime;
-        }
-
 
-        //Loop to calculate planet collisions with each other, and also prevent them phasing into each other
-        for (std::size_t x = 0; x < planets.size(); ++x)
-        {
-            for (std::size_t y = x + 1; y < planets.size(); ++y)
-            {
-                doPlanetPlanetCollision(planets[x], planets[y]);
-                preventSinking(planets[x], planets[y]);
-            }
+            //The overlay is left out, its text has to allocate whenever it's refreshed
+            allocationCheck.check(drawnPlanets);
+            profilerOverlay.draw(window, frameProfiler(), &simulation.getProfiler());
         }
 
-        window.clear(sf::Color::Black);
-
-        //Final loop to draw all the planets
-        for (Planet planet : planets)
         {
-            sf::CircleShape shape(planet.radius);
-            shape.setPosition(sf::Vector2f(static_cast<float>(planet.position.x),static_cast<float>(planet.position.y)));
-            shape.setOrigin({static_cast<float>(planet.radius), static_cast<float>(planet.radius)});
-            shape.setFillColor(planet.color);
-            //shape.setTexture(&planetTexture);
-            window.draw(shape);
+            GAME2_PROFILE_SCOPE(ProfilePhase::Display);
+            window.display();
         }
+        GAME2_PROFILE_END_FRAME();
+    }
 
-
-        window.display();
+    simulation.stop();
+    if (simulationSettings.traceOnExit)
+    {
+        writeTrace(simulationSettings.tracePath);
     }
 }
 
@@ -0,0 +1,460 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BarnesHut.h"
+#include "BodyStore.h"
+#include "FastMultipole.h"
+#include "Broadphase.h"
+#include "Collision.h"
+#include "GravityKernel.h"
+#include "ParticleMesh.h"
+#include "PlanetRenderer.h"
+#include "Scenarios.h"
+#include "ThreadPool.h"
+
+//Times the hot parts of a frame on the seeded scenarios and writes the results as JSON,
+//so runs on different commits can be compared. Everything runs without a window.
+//--accuracy instead weighs each approximate gravity solver's time against its error from the direct sum.
+
+struct BenchSettings
+{
+    std::vector<std::size_t> sizes = { 100, 1000, 10000, 100000 };
+    unsigned seed = 1;
+    unsigned threads = ThreadPool::hardwareThreads();
+    GravityKernel kernel = detectBestGravityKernel();
+    double theta = 0.5;
+    std::size_t meshSize = 256;
+    int multipoleOrder = 16;
+    double minSeconds = 0.5;        //Each case repeats until it has run at least this long...
+    int minIterations = 3;          //...and at least this many times
+    std::size_t maxDirectBodies = 10000; //Direct sum at 100k takes minutes per case, skipped above this unless raised
+    std::string outPath;            //Empty writes the JSON to stdout
+    std::string label;              //Free text copied into the JSON, e.g. the commit hash
+    bool accuracy = false;          //Compare each approximate solver against the direct sum instead of the timing cases
+    std::size_t accuracySamples = 1000; //Planets the direct sum reference is worked out for, so big scenes stay quick
+};
+
+struct BenchResult
+{
+    std::string benchmark;
+    Scenario scenario;
+    std::size_t bodies;
+    std::vector<double> times; //Milliseconds, one per iteration
+};
+
+//Relative error from the direct sum every sampled planet should be within for a solver setting to count as exact enough
+constexpr double accuracyTarget = 1.0e-6;
+
+//How far one solver setting is from the direct sum, for --accuracy
+struct AccuracyResult
+{
+    std::string solver;
+    double parameter;      //theta, grid size or expansion order, 0 for the direct sum
+    Scenario scenario;
+    std::size_t bodies;
+    double milliseconds;   //Median time for the whole force pass
+    double rmsError;       //sqrt(sum |a - direct|^2 / sum |direct|^2), dominated by the planets with the biggest accelerations
+    double medianError;    //|a - direct| / |direct| per planet
+    double maxError;       //Worst planet, what accuracyTarget is judged on
+    bool meetsTarget;
+};
+
+BenchSettings parseCommandLine(int argc, char* argv[])
+{
+    BenchSettings settings;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--sizes" && hasValue)
+        {
+            //Comma separated, e.g. 100,1000
+            settings.sizes.clear();
+            std::stringstream list(argv[++i]);
+            std::string size;
+            while (std::getline(list, size, ','))
+            {
+                settings.sizes.push_back(static_cast<std::size_t>(std::strtoull(size.c_str(), nullptr, 10)));
+            }
+        }
+        else if (arg == "--seed" && hasValue)
+        {
+            settings.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            settings.threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (arg == "--kernel" && hasValue)
+        {
+            std::string value = argv[++i];
+            GravityKernel requested = settings.kernel;
+            if (value == "scalar") requested = GravityKernel::Scalar;
+            else if (value == "sse") requested = GravityKernel::Sse;
+            else if (value == "avx2") requested = GravityKernel::Avx2;
+            else std::cerr << "Unknown kernel '" << value << "'" << std::endl;
+
+            if (isGravityKernelSupported(requested)) settings.kernel = requested;
+            else std::cerr << "This CPU doesn't support " << value << ", using " << gravityKernelName(settings.kernel) << std::endl;
+        }
+        else if (arg == "--theta" && hasValue)
+        {
+            settings.theta = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (arg == "--pm-grid" && hasValue)
+        {
+            settings.meshSize = static_cast<std::size_t>(std::max(16, std::atoi(argv[++i])));
+        }
+        else if (arg == "--fmm-order" && hasValue)
+        {
+            settings.multipoleOrder = std::clamp(std::atoi(argv[++i]), 1, FastMultipoleTree::maxOrder);
+        }
+        else if (arg == "--accuracy")
+        {
+            settings.accuracy = true;
+        }
+        else if (arg == "--samples" && hasValue)
+        {
+            settings.accuracySamples = std::max<std::size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--min-time" && hasValue)
+        {
+            settings.minSeconds = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (arg == "--min-iterations" && hasValue)
+        {
+            settings.minIterations = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--max-direct" && hasValue)
+        {
+            settings.maxDirectBodies = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--out" && hasValue)
+        {
+            settings.outPath = argv[++i];
+        }
+        else if (arg == "--label" && hasValue)
+        {
+            settings.label = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Ignoring unknown argument '" << arg << "'" << std::endl;
+        }
+    }
+
+    return settings;
+}
+
+//Runs setup (not timed) then body (timed) until both the time and iteration minimums are met
+std::vector<double> measure(const BenchSettings& settings, const std::function<void()>& setup, const std::function<void()>& body)
+{
+    //One untimed run first so caches, the thread pool and any vector growth are warmed up
+    setup();
+    body();
+
+    std::vector<double> times;
+    double total = 0.0;
+    while (static_cast<int>(times.size()) < settings.minIterations || total < settings.minSeconds * 1000.0)
+    {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        times.push_back(milliseconds);
+        total += milliseconds;
+    }
+    return times;
+}
+
+void runCases(const BenchSettings& settings, Scenario scenario, std::size_t count, ThreadPool& threadPool,
+    std::vector<BenchResult>& results)
+{
+    //Middle of the default 1920x1080 window
+    const std::vector<Planet> initial = generateScenario(scenario, count, settings.seed, { 9.6, 5.4 });
+    std::vector<Vector2d> planetAccelerations(initial.size());
+
+    auto record = [&](const char* benchmark, std::vector<double> times)
+    {
+        std::cerr << benchmark << " " << scenarioName(scenario) << " n=" << count << ": " << times.size() << " runs" << std::endl;
+        results.push_back({ benchmark, scenario, count, std::move(times) });
+    };
+
+    //Same steps as World::computePlanetAccelerations for each solver
+    if (count <= settings.maxDirectBodies)
+    {
+        BodyStore bodyStore;
+        record("gravity_direct", measure(settings, [] {}, [&]
+        {
+            bodyStore.loadFromPlanets(initial);
+            threadPool.parallelFor(initial.size(), 64, [&](std::size_t begin, std::size_t end, unsigned)
+            {
+                computeDirectSumAccelerations(bodyStore, planetAccelerations, settings.kernel, softening2, begin, end);
+            });
+        }));
+    }
+
+    BarnesHutTree tree;
+    record("gravity_barnes_hut", measure(settings, [] {}, [&]
+    {
+        computeBarnesHutAccelerations(initial, planetAccelerations, tree, settings.theta, softening2, threadPool);
+    }));
+
+    ParticleMesh mesh;
+    record("gravity_pm", measure(settings, [] {}, [&]
+    {
+        computeParticleMeshAccelerations(initial, planetAccelerations, mesh, settings.meshSize, softening2, threadPool);
+    }));
+
+    FastMultipoleTree fastMultipoleTree;
+    record("gravity_fmm", measure(settings, [] {}, [&]
+    {
+        computeFastMultipoleAccelerations(initial, planetAccelerations, fastMultipoleTree, settings.multipoleOrder, softening2, threadPool);
+    }));
+
+    //Collisions change the planets, so every run starts again from the scenario
+    std::vector<Planet> planets;
+    UniformGrid collisionGrid;
+    record("collisions", measure(settings, [&] { planets = initial; }, [&]
+    {
+        resolvePlanetCollisions(planets, collisionGrid);
+    }));
+
+    MergeScratch mergeScratch;
+    record("collisions_merge", measure(settings, [&] { planets = initial; }, [&]
+    {
+        mergeTouchingPlanets(planets, collisionGrid, mergeScratch);
+    }));
+
+    std::vector<RenderPlanet> renderPlanets;
+    for (const Planet& planet : initial)
+    {
+        sf::Vector2f position(planet.position);
+        renderPlanets.push_back({ position, position, static_cast<float>(planet.radius), planet.color });
+    }
+    std::vector<sf::Vertex> vertices;
+    const sf::FloatRect everything({ -1.0e6f, -1.0e6f }, { 2.0e6f, 2.0e6f });
+    record("render_vertices", measure(settings, [] {}, [&]
+    {
+        buildPlanetVertices(renderPlanets, 0.5f, everything, vertices, 256.f);
+    }));
+}
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+//Times every solver at a few settings and measures its error against the direct sum on an even spread of planets.
+//The direct sum is only timed in full up to maxDirectBodies, above that its time is scaled up from the sampled planets
+void runAccuracyCases(const BenchSettings& settings, Scenario scenario, std::size_t count, ThreadPool& threadPool,
+    std::vector<AccuracyResult>& results)
+{
+    const std::vector<Planet> planets = generateScenario(scenario, count, settings.seed, { 9.6, 5.4 });
+    std::vector<Vector2d> reference(planets.size());
+    std::vector<Vector2d> planetAccelerations(planets.size());
+    const std::size_t step = std::max<std::size_t>(1, planets.size() / settings.accuracySamples);
+    const std::size_t samples = (planets.size() + step - 1) / step;
+
+    BodyStore bodyStore;
+    bodyStore.loadFromPlanets(planets);
+    auto start = std::chrono::steady_clock::now();
+    threadPool.parallelFor(samples, 1, [&](std::size_t begin, std::size_t end, unsigned)
+    {
+        for (std::size_t sample = begin; sample < end; ++sample)
+        {
+            computeDirectSumAccelerations(bodyStore, reference, settings.kernel, softening2, sample * step, sample * step + 1);
+        }
+    });
+    double directMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+        * static_cast<double>(planets.size()) / static_cast<double>(samples);
+
+    if (count <= settings.maxDirectBodies)
+    {
+        directMilliseconds = median(measure(settings, [] {}, [&]
+        {
+            bodyStore.loadFromPlanets(planets);
+            threadPool.parallelFor(planets.size(), 64, [&](std::size_t begin, std::size_t end, unsigned)
+            {
+                computeDirectSumAccelerations(bodyStore, planetAccelerations, settings.kernel, softening2, begin, end);
+            });
+        }));
+    }
+    results.push_back({ "direct", 0.0, scenario, count, directMilliseconds, 0.0, 0.0, 0.0, true });
+
+    auto compare = [&](const char* solver, double parameter, const std::function<void()>& body)
+    {
+        double milliseconds = median(measure(settings, [] {}, body));
+
+        double errorSum = 0.0;
+        double referenceSum = 0.0;
+        std::vector<double> errors;
+        for (std::size_t i = 0; i < planets.size(); i += step)
+        {
+            double dx = planetAccelerations[i].x - reference[i].x;
+            double dy = planetAccelerations[i].y - reference[i].y;
+            double reference2 = reference[i].x * reference[i].x + reference[i].y * reference[i].y;
+            errorSum += dx * dx + dy * dy;
+            referenceSum += reference2;
+            if (reference2 > 0.0)
+            {
+                errors.push_back(std::sqrt((dx * dx + dy * dy) / reference2));
+            }
+        }
+        double rmsError = referenceSum > 0.0 ? std::sqrt(errorSum / referenceSum) : 0.0;
+        double medianError = errors.empty() ? 0.0 : median(errors);
+        double maxError = errors.empty() ? 0.0 : *std::max_element(errors.begin(), errors.end());
+        bool meetsTarget = maxError <= accuracyTarget;
+        results.push_back({ solver, parameter, scenario, count, milliseconds, rmsError, medianError, maxError, meetsTarget });
+        std::cerr << solver << " " << parameter << " " << scenarioName(scenario) << " n=" << count << ": " << milliseconds
+            << " ms, median error " << medianError << ", max error " << maxError
+            << (meetsTarget ? ", within " : ", outside ") << accuracyTarget << std::endl;
+    };
+
+    BarnesHutTree tree;
+    for (double theta : { 1.0, 0.7, 0.5, 0.3 })
+    {
+        compare("barnes-hut", theta, [&]
+        {
+            computeBarnesHutAccelerations(planets, planetAccelerations, tree, theta, softening2, threadPool);
+        });
+    }
+
+    ParticleMesh mesh;
+    for (std::size_t meshSize : { 128, 256, 512 })
+    {
+        compare("pm", static_cast<double>(meshSize), [&]
+        {
+            computeParticleMeshAccelerations(planets, planetAccelerations, mesh, meshSize, softening2, threadPool);
+        });
+    }
+
+    FastMultipoleTree fastMultipoleTree;
+    for (int order : { 4, 6, 8, 10, 12, 14, 16, 18 })
+    {
+        compare("fmm", order, [&]
+        {
+            computeFastMultipoleAccelerations(planets, planetAccelerations, fastMultipoleTree, order, softening2, threadPool);
+        });
+    }
+}
+
+//Quotes and backslashes are the only characters a label is likely to have that JSON needs escaped
+std::string jsonString(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+void writeJson(std::ostream& out, const BenchSettings& settings, const std::vector<BenchResult>& results)
+{
+    out.precision(9);
+    out << "{\n";
+    out << "  \"label\": " << jsonString(settings.label) << ",\n";
+    out << "  \"seed\": " << settings.seed << ",\n";
+    out << "  \"threads\": " << settings.threads << ",\n";
+    out << "  \"kernel\": \"" << gravityKernelName(settings.kernel) << "\",\n";
+    out << "  \"theta\": " << settings.theta << ",\n";
+    out << "  \"pm_grid\": " << settings.meshSize << ",\n";
+    out << "  \"fmm_order\": " << settings.multipoleOrder << ",\n";
+    out << "  \"results\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        std::vector<double> sorted = results[i].times;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0.0;
+        for (double time : sorted)
+        {
+            mean += time;
+        }
+        mean /= sorted.size();
+
+        out << "    { \"benchmark\": \"" << results[i].benchmark << "\", \"scenario\": \"" << scenarioName(results[i].scenario)
+            << "\", \"bodies\": " << results[i].bodies << ", \"iterations\": " << sorted.size()
+            << ", \"mean_ms\": " << mean << ", \"median_ms\": " << sorted[sorted.size() / 2]
+            << ", \"min_ms\": " << sorted.front() << ", \"max_ms\": " << sorted.back() << " }"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+}
+
+void writeAccuracyJson(std::ostream& out, const BenchSettings& settings, const std::vector<AccuracyResult>& results)
+{
+    out.precision(9);
+    out << "{\n";
+    out << "  \"label\": " << jsonString(settings.label) << ",\n";
+    out << "  \"seed\": " << settings.seed << ",\n";
+    out << "  \"threads\": " << settings.threads << ",\n";
+    out << "  \"kernel\": \"" << gravityKernelName(settings.kernel) << "\",\n";
+    out << "  \"samples\": " << settings.accuracySamples << ",\n";
+    out << "  \"target_error\": " << accuracyTarget << ",\n";
+    out << "  \"accuracy\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const AccuracyResult& result = results[i];
+        out << "    { \"solver\": \"" << result.solver << "\", \"parameter\": " << result.parameter
+            << ", \"scenario\": \"" << scenarioName(result.scenario) << "\", \"bodies\": " << result.bodies
+            << ", \"ms\": " << result.milliseconds << ", \"rms_error\": " << result.rmsError
+            << ", \"median_error\": " << result.medianError << ", \"max_error\": " << result.maxError
+            << ", \"meets_target\": " << (result.meetsTarget ? "true" : "false") << " }"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+}
+
+int main(int argc, char* argv[])
+{
+    BenchSettings settings = parseCommandLine(argc, argv);
+    ThreadPool threadPool(settings.threads);
+
+    std::vector<BenchResult> results;
+    std::vector<AccuracyResult> accuracyResults;
+    for (Scenario scenario : { Scenario::UniformDisk, Scenario::PlummerSphere, Scenario::CollidingClusters })
+    {
+        for (std::size_t count : settings.sizes)
+        {
+            if (settings.accuracy) runAccuracyCases(settings, scenario, count, threadPool, accuracyResults);
+            else runCases(settings, scenario, count, threadPool, results);
+        }
+    }
+
+    std::ofstream file;
+    if (!settings.outPath.empty())
+    {
+        file.open(settings.outPath);
+        if (!file)
+        {
+            std::cerr << "Couldn't create " << settings.outPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = settings.outPath.empty() ? std::cout : file;
+
+    if (settings.accuracy) writeAccuracyJson(out, settings, accuracyResults);
+    else writeJson(out, settings, results);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+//Counts every call to the global operator new, so it's easy to check that a steady-state step or frame
+//doesn't touch the heap. On in debug builds (_DEBUG) or with GAME2_COUNT_ALLOCATIONS defined, release builds
+//keep the normal operator new and the count stays at 0.
+#if defined(_DEBUG) && !defined(GAME2_COUNT_ALLOCATIONS)
+#define GAME2_COUNT_ALLOCATIONS
+#endif
+
+#if defined(GAME2_COUNT_ALLOCATIONS)
+constexpr bool allocationCounterEnabled = true;
+#else
+constexpr bool allocationCounterEnabled = false;
+#endif
+
+//Heap allocations made by any thread since the program started
+std::uint64_t heapAllocationCount();
@@ -0,0 +1,218 @@
+#include "BarnesHut.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+void BarnesHutTree::build(const std::vector<Planet>& planets)
+{
+    nodes.clear();
+    nextInLeaf.assign(planets.size(), -1);
+
+    if (planets.empty())
+    {
+        return;
+    }
+
+    //Square bounds around every planet so each quadrant is also square
+    double minX = planets[0].position.x, maxX = minX;
+    double minY = planets[0].position.y, maxY = minY;
+    for (const Planet& planet : planets)
+    {
+        minX = std::min(minX, planet.position.x);
+        maxX = std::max(maxX, planet.position.x);
+        minY = std::min(minY, planet.position.y);
+        maxY = std::max(maxY, planet.position.y);
+    }
+
+    Node root;
+    root.centerX = (minX + maxX) / 2.0;
+    root.centerY = (minY + maxY) / 2.0;
+    root.halfSize = std::max(maxX - minX, maxY - minY) / 2.0 + 1.0;
+    nodes.push_back(root);
+
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        insert(static_cast<int>(i), planets);
+    }
+
+    //Masses were summed as mass * position while inserting, turn that into the actual center of mass
+    for (Node& node : nodes)
+    {
+        if (node.mass > 0.0)
+        {
+            node.comX /= node.mass;
+            node.comY /= node.mass;
+        }
+    }
+}
+
+void BarnesHutTree::insert(int index, const std::vector<Planet>& planets)
+{
+    const Planet& planet = planets[index];
+    const double x = planet.position.x;
+    const double y = planet.position.y;
+
+    int node = 0;
+    int depth = 0;
+    while (true)
+    {
+        nodes[node].mass += planet.mass;
+        nodes[node].comX += planet.mass * x;
+        nodes[node].comY += planet.mass * y;
+
+        if (nodes[node].firstChild != -1)
+        {
+            node = childFor(node, x, y);
+            ++depth;
+            continue;
+        }
+
+        //Empty leaf, planet goes here
+        if (nodes[node].firstBody == -1)
+        {
+            nodes[node].firstBody = index;
+            return;
+        }
+
+        //Planets sitting on top of each other would split forever, just share the leaf
+        if (depth >= maxDepth)
+        {
+            nextInLeaf[index] = nodes[node].firstBody;
+            nodes[node].firstBody = index;
+            return;
+        }
+
+        //Occupied leaf, split it and push the planet already here down into its child
+        int existing = nodes[node].firstBody;
+        nodes[node].firstBody = -1;
+        subdivide(node);
+
+        const Planet& other = planets[existing];
+        int otherChild = childFor(node, other.position.x, other.position.y);
+        nodes[otherChild].firstBody = existing;
+        nodes[otherChild].mass = other.mass;
+        nodes[otherChild].comX = other.mass * other.position.x;
+        nodes[otherChild].comY = other.mass * other.position.y;
+
+        node = childFor(node, x, y);
+        ++depth;
+    }
+}
+
+void BarnesHutTree::subdivide(int node)
+{
+    //Copy out of the node first, push_back can reallocate
+    const double quarter = nodes[node].halfSize / 2.0;
+    const double cx = nodes[node].centerX;
+    const double cy = nodes[node].centerY;
+
+    nodes[node].firstChild = static_cast<int>(nodes.size());
+    for (int quadrant = 0; quadrant < 4; ++quadrant)
+    {
+        Node child;
+        child.centerX = cx + ((quadrant & 1) ? quarter : -quarter);
+        child.centerY = cy + ((quadrant & 2) ? quarter : -quarter);
+        child.halfSize = quarter;
+        nodes.push_back(child);
+    }
+}
+
+int BarnesHutTree::childFor(int node, double x, double y) const
+{
+    int quadrant = 0;
+    if (x >= nodes[node].centerX) quadrant |= 1;
+    if (y >= nodes[node].centerY) quadrant |= 2;
+    return nodes[node].firstChild + quadrant;
+}
+
+Vector2d BarnesHutTree::accelerationOn(std::size_t index, const std::vector<Planet>& planets, double theta, double softening2) const
+{
+    if (nodes.empty())
+    {
+        return { 0.0, 0.0 };
+    }
+
+    const double px = planets[index].position.x;
+    const double py = planets[index].position.y;
+    const double theta2 = theta * theta;
+
+    double ax = 0.0;
+    double ay = 0.0;
+
+    //Each node pops one and pushes at most four, so the stack never grows past 3 per level
+    std::array<int, 3 * maxDepth + 4> stack;
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node& node = nodes[stack[--top]];
+        if (node.mass <= 0.0)
+        {
+            continue;
+        }
+
+        if (node.firstChild == -1)
+        {
+            //Leaf, add every planet in it exactly (skipping the planet itself)
+            for (int body = node.firstBody; body != -1; body = nextInLeaf[body])
+            {
+                if (static_cast<std::size_t>(body) == index)
+                {
+                    continue;
+                }
+                double rx = planets[body].position.x - px;
+                double ry = planets[body].position.y - py;
+                double distance2 = rx * rx + ry * ry;
+                if (distance2 == 0.0)
+                {
+                    continue;
+                }
+                double softened2 = distance2 + softening2;
+                double magnitude = G * planets[body].mass / (softened2 * std::sqrt(softened2));
+                ax += rx * magnitude;
+                ay += ry * magnitude;
+            }
+            continue;
+        }
+
+        double rx = node.comX - px;
+        double ry = node.comY - py;
+        double distance2 = rx * rx + ry * ry;
+        double width = node.halfSize * 2.0;
+
+        //Node is far enough away (width / distance < theta), treat it as one planet at its center of mass.
+        //A node holding this planet is always opened, at big theta its center of mass can pass the test and the
+        //planet would be pulled by its own mass
+        bool holdsPlanet = std::abs(px - node.centerX) <= node.halfSize && std::abs(py - node.centerY) <= node.halfSize;
+        if (!holdsPlanet && width * width < theta2 * distance2)
+        {
+            double softened2 = distance2 + softening2;
+            double magnitude = G * node.mass / (softened2 * std::sqrt(softened2));
+            ax += rx * magnitude;
+            ay += ry * magnitude;
+            continue;
+        }
+
+        for (int quadrant = 0; quadrant < 4; ++quadrant)
+        {
+            stack[top++] = node.firstChild + quadrant;
+        }
+    }
+
+    return { ax, ay };
+}
+
+void computeBarnesHutAccelerations(const std::vector<Planet>& planets, std::vector<Vector2d>& planetAccelerations,
+    BarnesHutTree& tree, double theta, double softening2, ThreadPool& threadPool)
+{
+    tree.build(planets);
+    threadPool.parallelFor(planets.size(), 256, [&](std::size_t begin, std::size_t end, unsigned)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            planetAccelerations[i] = tree.accelerationOn(i, planets, theta, softening2);
+        }
+    });
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Physics.h"
+#include "ThreadPool.h"
+#include <vector>
+
+//Quadtree used to approximate gravity from far away groups of planets as a single mass (Barnes-Hut).
+//The tree is rebuilt every frame, the node storage is kept between builds so it doesn't reallocate.
+struct BarnesHutTree
+{
+    struct Node
+    {
+        double centerX, centerY, halfSize; //Square bounds of this node
+        double mass = 0.0;
+        double comX = 0.0, comY = 0.0;      //Center of mass
+        int firstChild = -1;                //Index of the first of 4 children, -1 if this is a leaf
+        int firstBody = -1;                 //Leaf only, first planet in this leaf (more than one only at maxDepth)
+    };
+
+    //Stops coincident planets from splitting forever, planets past this depth share a leaf
+    static constexpr int maxDepth = 32;
+
+    std::vector<Node> nodes;
+    std::vector<int> nextInLeaf; //Linked list of planets that share a leaf
+
+public:
+    void build(const std::vector<Planet>& planets);
+
+    //Acceleration on planets[index] from every other planet. theta is the opening angle, 0 gives the exact direct sum.
+    //Softened the same way as the direct sum, far nodes included
+    Vector2d accelerationOn(std::size_t index, const std::vector<Planet>& planets, double theta, double softening2) const;
+
+private:
+    void insert(int index, const std::vector<Planet>& planets);
+    void subdivide(int node);
+    int childFor(int node, double x, double y) const;
+};
+
+//Fills planetAccelerations the same way the direct sum loop does, but in O(n log n).
+//The tree is built on one thread, the walks for each planet are split across the pool.
+void computeBarnesHutAccelerations(const std::vector<Planet>& planets, std::vector<Vector2d>& planetAccelerations,
+    BarnesHutTree& tree, double theta, double softening2, ThreadPool& threadPool);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Physics.h"
+#include <cstddef>
+#include <new>
+#include <vector>
+
+//Allocator that lines arrays up on a boundary so SIMD loads don't straddle cache lines
+template <typename T, std::size_t Alignment>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* pointer, std::size_t)
+    {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T, 32>>;
+
+//Planet data split into one array per field (structure of arrays), so the gravity loop
+//only touches the positions and masses it needs and can load 4 planets at a time. Same precision as Planet, so
+//filling it is a straight copy and the gravity loop has no conversions in it.
+struct BodyStore
+{
+    //Arrays are padded to a multiple of this with massless planets so SIMD loops need no tail
+    static constexpr std::size_t lanePadding = 8;
+
+    AlignedVector<double> x, y;
+    AlignedVector<double> vx, vy;
+    AlignedVector<double> mass;
+    AlignedVector<double> radius;
+
+    std::size_t count = 0;       //Real planets
+    std::size_t paddedCount = 0; //Real planets plus padding
+
+public:
+    void loadFromPlanets(const std::vector<Planet>& planets)
+    {
+        count = planets.size();
+        paddedCount = (count + lanePadding - 1) / lanePadding * lanePadding;
+
+        //assign keeps the capacity, so this only allocates when the planet count grows
+        x.assign(paddedCount, 0.0);
+        y.assign(paddedCount, 0.0);
+        vx.assign(paddedCount, 0.0);
+        vy.assign(paddedCount, 0.0);
+        mass.assign(paddedCount, 0.0);
+        radius.assign(paddedCount, 0.0);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            x[i] = planets[i].position.x;
+            y[i] = planets[i].position.y;
+            vx[i] = planets[i].velocity.x;
+            vy[i] = planets[i].velocity.y;
+            mass[i] = planets[i].mass;
+            radius[i] = planets[i].radius;
+        }
+    }
+};
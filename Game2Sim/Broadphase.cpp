@@ -0,0 +1,113 @@
+#include "Broadphase.h"
+
+#include <algorithm>
+#include <cmath>
+
+std::int64_t UniformGrid::cellCoordinate(double value) const
+{
+    return static_cast<std::int64_t>(std::floor(value / cellSize));
+}
+
+std::size_t UniformGrid::bucketFor(std::int64_t cellX, std::int64_t cellY) const
+{
+    //Large primes mix the two coordinates so neighbouring cells land in different buckets
+    std::uint64_t hash = static_cast<std::uint64_t>(cellX) * 73856093ull ^ static_cast<std::uint64_t>(cellY) * 19349663ull;
+    return static_cast<std::size_t>(hash) & tableMask;
+}
+
+void UniformGrid::build(const std::vector<Planet>& planets)
+{
+    double maxRadius = 0.0;
+    for (const Planet& planet : planets)
+    {
+        maxRadius = std::max(maxRadius, planet.radius);
+    }
+    cellSize = maxRadius > 0.0 ? maxRadius * 2.0 : 1.0;
+
+    //Power of two table with about 2 buckets per planet keeps collisions between cells rare
+    std::size_t tableSize = 16;
+    while (tableSize < planets.size() * 2)
+    {
+        tableSize *= 2;
+    }
+    tableMask = tableSize - 1;
+
+    //Counting sort of planets by bucket, all the vectors keep their capacity between frames
+    bucketStart.assign(tableSize + 1, 0);
+    planetBucket.resize(planets.size());
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        std::size_t bucket = bucketFor(cellCoordinate(planets[i].position.x), cellCoordinate(planets[i].position.y));
+        planetBucket[i] = static_cast<std::uint32_t>(bucket);
+        ++bucketStart[bucket + 1];
+    }
+    for (std::size_t bucket = 0; bucket < tableSize; ++bucket)
+    {
+        bucketStart[bucket + 1] += bucketStart[bucket];
+    }
+
+    bucketEntries.resize(planets.size());
+    bucketCursor.assign(bucketStart.begin(), bucketStart.end() - 1);
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        bucketEntries[bucketCursor[planetBucket[i]]++] = static_cast<std::uint32_t>(i);
+    }
+}
+
+const std::vector<UniformGrid::PlanetPair>& UniformGrid::findCandidatePairs(const std::vector<Planet>& planets, bool skipSleepingPairs)
+{
+    candidatePairs.clear();
+    if (planets.size() < 2)
+    {
+        return candidatePairs;
+    }
+
+    build(planets);
+
+    for (std::size_t a = 0; a < planets.size(); ++a)
+    {
+        //Pairs with a sleeping planet come from the awake planet's side instead
+        if (skipSleepingPairs && planets[a].asleep)
+        {
+            continue;
+        }
+
+        std::int64_t cellX = cellCoordinate(planets[a].position.x);
+        std::int64_t cellY = cellCoordinate(planets[a].position.y);
+
+        //Two of the 9 neighbouring cells can hash to the same bucket, only look at each bucket once
+        std::size_t visited[9];
+        int visitedCount = 0;
+
+        for (std::int64_t offsetY = -1; offsetY <= 1; ++offsetY)
+        {
+            for (std::int64_t offsetX = -1; offsetX <= 1; ++offsetX)
+            {
+                std::size_t bucket = bucketFor(cellX + offsetX, cellY + offsetY);
+                if (std::find(visited, visited + visitedCount, bucket) != visited + visitedCount)
+                {
+                    continue;
+                }
+                visited[visitedCount++] = bucket;
+
+                for (std::uint32_t entry = bucketStart[bucket]; entry < bucketStart[bucket + 1]; ++entry)
+                {
+                    std::uint32_t b = bucketEntries[entry];
+                    //Only b > a so every pair comes out once, sleeping b were skipped above so they're always taken here
+                    if (b > a)
+                    {
+                        candidatePairs.push_back({ static_cast<std::uint32_t>(a), b });
+                    }
+                    else if (skipSleepingPairs && planets[b].asleep)
+                    {
+                        candidatePairs.push_back({ b, static_cast<std::uint32_t>(a) });
+                    }
+                }
+            }
+        }
+    }
+
+    //Same order the old all pairs loop used, so collisions resolve the same way
+    std::sort(candidatePairs.begin(), candidatePairs.end());
+    return candidatePairs;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Physics.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//Spatial hash used to find which planets might be touching without checking every pair.
+//Cells are 2 * the largest radius wide, so two touching planets are always in the same or neighbouring cells.
+//That means one big planet makes the cells coarse for everyone: planets 10 times smaller than it share a cell with
+//about 100 times as many neighbours. That is accepted, planets here come in a narrow range of sizes and merged ones
+//only grow with the square root of their mass. A field of mixed sizes would want big planets checked in a pass of their own.
+//Cells are hashed into a table so planets spread far apart don't need a huge grid.
+struct UniformGrid
+{
+    using PlanetPair = std::pair<std::uint32_t, std::uint32_t>;
+
+    double cellSize = 1.0;
+    std::size_t tableMask = 0;
+
+    std::vector<std::uint32_t> bucketStart;  //bucketEntries[bucketStart[b] .. bucketStart[b + 1]) are the planets in bucket b
+    std::vector<std::uint32_t> bucketEntries;
+    std::vector<std::uint32_t> planetBucket; //Bucket each planet went into
+    std::vector<std::uint32_t> bucketCursor; //Next free slot in each bucket while filling bucketEntries
+    std::vector<PlanetPair> candidatePairs;  //Pairs (a, b) with a < b, sorted
+
+public:
+    //Fills candidatePairs with every pair of planets close enough that they could be touching.
+    //skipSleepingPairs leaves out pairs where both planets are asleep, so a sleeping pile adds almost nothing
+    const std::vector<PlanetPair>& findCandidatePairs(const std::vector<Planet>& planets, bool skipSleepingPairs = false);
+
+private:
+    void build(const std::vector<Planet>& planets);
+    std::int64_t cellCoordinate(double value) const;
+    std::size_t bucketFor(std::int64_t cellX, std::int64_t cellY) const;
+};
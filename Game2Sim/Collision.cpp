@@ -0,0 +1,175 @@
+#include "Collision.h"
+
+#include <algorithm>
+#include <cmath>
+
+const char* collisionModeName(CollisionMode mode)
+{
+    return mode == CollisionMode::Merge ? "merge" : "bounce";
+}
+
+//Function to calculate planet velocity after a collision with another planet
+void doPlanetPlanetCollision(Planet& p1, Planet& p2, double restitution)
+{
+    double minimumDistance = p1.radius + p2.radius;
+    double distBetweenPlanetCenters = std::sqrt((p2.position.x-p1.position.x)*(p2.position.x-p1.position.x) + (p2.position.y-p1.position.y)*(p2.position.y-p1.position.y));
+
+    if (minimumDistance >= distBetweenPlanetCenters) {
+        Vector2d norm = (p2.position - p1.position) / distBetweenPlanetCenters;
+        double pValue = (2 * (p1.velocity.x * norm.x + p1.velocity.y * norm.y - p2.velocity.x * norm.x - p2.velocity.y * norm.y))/(p1.mass+p2.mass);
+
+        p1.velocity = (p1.velocity - multiplyVectorByDouble(norm, pValue * p1.mass)) * restitution;
+        p2.velocity = (p2.velocity + multiplyVectorByDouble(norm, pValue * p2.mass)) * restitution;
+    }
+    else {
+        return;
+    }
+}
+
+
+//Function to prevent 2 planets from slowly sinking into each other once they are resting against each other
+void preventSinking(Planet& p1, Planet& p2)
+{
+    const double minDist = p1.radius + p2.radius;
+    Vector2d d = p2.position - p1.position;
+    double dist = len(d);
+    if (dist >= minDist || dist == 0.0) return;
+
+    Vector2d n = d / dist; // contact normal
+    double penetration = minDist - dist;
+
+    // Move each planet out along the normal, weighted by mass
+    double invA = (p1.mass > 0.0) ? 1.0 / p1.mass : 0.0;
+    double invB = (p2.mass > 0.0) ? 1.0 / p2.mass : 0.0;
+
+    const double slop = 1e-4; // (meters) ignore tiny overlap to avoid jitter
+    const double percent = 0.8; // 1.0 is push fully out (set 0.8 for softer)
+    double corrMag = std::max(penetration - slop, 0.0) / (invA + invB) * percent;
+
+    Vector2d correction = corrMag * n;
+    p1.position -= invA * correction;
+    p2.position += invB * correction;
+
+    // (optional) kill closing motion along the normal to keep them resting
+    Vector2d rv = p2.velocity - p1.velocity;
+    double vn = rv.x * n.x + rv.y * n.y;
+    if (vn < 0.0) {
+        Vector2d vnVec = vn * n;
+        p1.velocity += invA * vnVec;
+        p2.velocity -= invB * vnVec;
+    }
+}
+
+void resolvePlanetCollisions(std::vector<Planet>& planets, UniformGrid& collisionGrid)
+{
+    for (const UniformGrid::PlanetPair& pair : collisionGrid.findCandidatePairs(planets))
+    {
+        Planet& p1 = planets[pair.first];
+        Planet& p2 = planets[pair.second];
+
+        //Cheap squared distance check first, both functions below do nothing unless the planets touch
+        Vector2d d = p2.position - p1.position;
+        double minDist = p1.radius + p2.radius;
+        if (dot(d, d) > minDist * minDist)
+        {
+            continue;
+        }
+
+        doPlanetPlanetCollision(p1, p2);
+        preventSinking(p1, p2);
+    }
+}
+
+void absorbPlanet(Planet& survivor, const Planet& absorbed)
+{
+    double mass = survivor.mass + absorbed.mass;
+    //Only weights, so massless planets just average
+    double survivorWeight = mass > 0.0 ? survivor.mass / mass : 0.5;
+    double absorbedWeight = 1.0 - survivorWeight;
+
+    survivor.position = survivor.position * survivorWeight + absorbed.position * absorbedWeight;
+    survivor.velocity = survivor.velocity * survivorWeight + absorbed.velocity * absorbedWeight;
+    survivor.radius = std::sqrt(survivor.radius * survivor.radius + absorbed.radius * absorbed.radius);
+    survivor.mass = mass;
+
+    auto mix = [&](std::uint8_t a, std::uint8_t b)
+    {
+        return static_cast<std::uint8_t>(std::lround(a * survivorWeight + b * absorbedWeight));
+    };
+    survivor.color = sf::Color(mix(survivor.color.r, absorbed.color.r), mix(survivor.color.g, absorbed.color.g),
+        mix(survivor.color.b, absorbed.color.b), mix(survivor.color.a, absorbed.color.a));
+}
+
+std::uint32_t findGroup(std::vector<std::uint32_t>& group, std::uint32_t planet)
+{
+    while (group[planet] != planet)
+    {
+        group[planet] = group[group[planet]];
+        planet = group[planet];
+    }
+    return planet;
+}
+
+std::size_t mergeTouchingPlanets(std::vector<Planet>& planets, UniformGrid& collisionGrid, MergeScratch& scratch)
+{
+    std::vector<std::uint32_t>& group = scratch.group;
+    group.resize(planets.size());
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        group[i] = static_cast<std::uint32_t>(i);
+    }
+
+    //Which planets touch is decided from the positions before anything merges, so the result doesn't depend on pair order
+    bool anyTouching = false;
+    for (const UniformGrid::PlanetPair& pair : collisionGrid.findCandidatePairs(planets))
+    {
+        const Planet& p1 = planets[pair.first];
+        const Planet& p2 = planets[pair.second];
+        Vector2d d = p2.position - p1.position;
+        double minDist = p1.radius + p2.radius;
+        if (dot(d, d) > minDist * minDist)
+        {
+            continue;
+        }
+
+        std::uint32_t a = findGroup(group, pair.first);
+        std::uint32_t b = findGroup(group, pair.second);
+        if (a != b)
+        {
+            //Lower index stays the root, so it's the planet that's kept
+            group[std::max(a, b)] = std::min(a, b);
+            anyTouching = true;
+        }
+    }
+
+    if (!anyTouching)
+    {
+        return 0;
+    }
+
+    //Roots always come before the rest of their group, so each planet is added to a root that is still in place
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        std::uint32_t root = findGroup(group, static_cast<std::uint32_t>(i));
+        if (root != i)
+        {
+            absorbPlanet(planets[root], planets[i]);
+        }
+    }
+
+    std::vector<std::uint32_t>& keptFrom = scratch.keptFrom;
+    keptFrom.clear();
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        if (group[i] == i)
+        {
+            planets[kept++] = planets[i];
+            keptFrom.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    std::size_t removed = planets.size() - kept;
+    planets.resize(kept);
+    return removed;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Broadphase.h"
+#include "Physics.h"
+#include <cstdint>
+#include <vector>
+
+//What happens when two planets touch
+enum class CollisionMode
+{
+    Bounce, //Bounce off each other with some energy lost, resting planets are pushed apart every step
+    Merge   //Stick together as one planet (accretion), so the planet count shrinks over time
+};
+
+const char* collisionModeName(CollisionMode mode);
+
+//Function to calculate planet velocity after a collision with another planet
+void doPlanetPlanetCollision(Planet& p1, Planet& p2, double restitution = 0.8);
+
+//Function to prevent 2 planets from slowly sinking into each other once they are resting against each other
+void preventSinking(Planet& p1, Planet& p2);
+
+//Loop to calculate planet collisions with each other, and also prevent them phasing into each other.
+//Only pairs the grid says are close get checked, instead of every pair.
+void resolvePlanetCollisions(std::vector<Planet>& planets, UniformGrid& collisionGrid);
+
+//Kept by the caller so merging doesn't allocate every step
+struct MergeScratch
+{
+    std::vector<std::uint32_t> group;     //Union-find parent, the lowest index in a group is its root
+    std::vector<std::uint32_t> keptFrom;  //After merging, keptFrom[i] is the old index of the planet now at i
+};
+
+//Union-find lookup: the root of planet's group, halving the path on the way so later lookups are quicker
+std::uint32_t findGroup(std::vector<std::uint32_t>& group, std::uint32_t planet);
+
+//Adds planet `absorbed` into `survivor`: masses add, momentum and center of mass are kept,
+//and the areas add so the radius is sqrt(r1^2 + r2^2) (the simulation is flat, so area stands in for volume).
+//Colour is mixed by mass
+void absorbPlanet(Planet& survivor, const Planet& absorbed);
+
+//Merges every group of touching planets (including chains, A touching B touching C) into the lowest indexed planet
+//of the group, then removes the rest. Planets keep their order. Returns how many were removed, if any were
+//scratch.keptFrom says where each remaining planet was so arrays that run alongside planets can be compacted too.
+std::size_t mergeTouchingPlanets(std::vector<Planet>& planets, UniformGrid& collisionGrid, MergeScratch& scratch);
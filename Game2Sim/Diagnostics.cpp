@@ -0,0 +1,80 @@
+#include "Diagnostics.h"
+
+#include <algorithm>
+#include <cmath>
+
+EnergyMomentum measureEnergyMomentum(const std::vector<Planet>& planets, double softening2, ThreadPool& threadPool, std::vector<double>& rowScratch)
+{
+    EnergyMomentum measured;
+
+    for (const Planet& planet : planets)
+    {
+        double vx = planet.velocity.x;
+        double vy = planet.velocity.y;
+        measured.kinetic += 0.5 * planet.mass * (vx * vx + vy * vy);
+        measured.momentumX += planet.mass * vx;
+        measured.momentumY += planet.mass * vy;
+        measured.angularMomentum += planet.mass * (planet.position.x * vy - planet.position.y * vx);
+    }
+
+    //Each pair once (j > i). The Plummer potential -G*m1*m2 / sqrt(r^2 + eps^2) is the one the softened force comes from,
+    //so energy is conserved with softening on. Planets on top of each other only get skipped when softening is off
+    rowScratch.assign(planets.size(), 0.0);
+    threadPool.parallelFor(planets.size(), 32, [&](std::size_t begin, std::size_t end, unsigned)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            double row = 0.0;
+            for (std::size_t j = i + 1; j < planets.size(); ++j)
+            {
+                double dx = planets[j].position.x - planets[i].position.x;
+                double dy = planets[j].position.y - planets[i].position.y;
+                double distance = std::sqrt(dx * dx + dy * dy + softening2);
+                if (distance == 0.0)
+                {
+                    continue;
+                }
+                row += planets[j].mass / distance;
+            }
+            rowScratch[i] = -G * planets[i].mass * row;
+        }
+    });
+
+    for (double row : rowScratch)
+    {
+        measured.potential += row;
+    }
+
+    return measured;
+}
+
+bool DiagnosticsLog::open(const std::string& path, long long everySteps)
+{
+    file.open(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    //Energy errors are tiny next to the energy itself, so keep plenty of digits
+    file.precision(12);
+    interval = std::max(everySteps, 1LL);
+    hasInitialEnergy = false;
+    file << "step,time,kinetic,potential,total,relative_energy_error,momentum_x,momentum_y,angular_momentum\n";
+    return true;
+}
+
+void DiagnosticsLog::record(long long step, double time, const EnergyMomentum& measured)
+{
+    if (!hasInitialEnergy)
+    {
+        initialEnergy = measured.total();
+        hasInitialEnergy = true;
+    }
+
+    double energyError = initialEnergy != 0.0 ? (measured.total() - initialEnergy) / std::abs(initialEnergy) : 0.0;
+
+    file << step << ',' << time << ','
+        << measured.kinetic << ',' << measured.potential << ',' << measured.total() << ',' << energyError << ','
+        << measured.momentumX << ',' << measured.momentumY << ',' << measured.angularMomentum << '\n';
+}
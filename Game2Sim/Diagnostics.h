@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Physics.h"
+#include "ThreadPool.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+//Conserved quantities of the whole system, used to check a run is physically sane.
+//SI units, same as the simulation (joules, kg m/s, kg m^2/s).
+struct EnergyMomentum
+{
+    double kinetic = 0.0;
+    double potential = 0.0;        //Uses the same G and softening as the force pass
+    double momentumX = 0.0;
+    double momentumY = 0.0;
+    double angularMomentum = 0.0;  //About the origin
+
+    double total() const { return kinetic + potential; }
+};
+
+//Potential is O(n^2), so it's split over the pool. Each planet's share is summed separately then added up in
+//planet order, so the result doesn't change with the thread count. rowScratch is kept by the caller to avoid reallocating.
+EnergyMomentum measureEnergyMomentum(const std::vector<Planet>& planets, double softening2, ThreadPool& threadPool, std::vector<double>& rowScratch);
+
+//Writes energy and momentum to a CSV file every `interval` steps
+struct DiagnosticsLog
+{
+    std::ofstream file;
+    long long interval = 100;
+    bool hasInitialEnergy = false;
+    double initialEnergy = 0.0; //Energy error is measured against the first row
+
+public:
+    //Returns false if the file can't be created
+    bool open(const std::string& path, long long interval);
+    bool isOpen() const { return file.is_open(); }
+
+    //True if a row should be written after this step
+    bool isDue(long long step) const { return isOpen() && step % interval == 0; }
+
+    void record(long long step, double time, const EnergyMomentum& measured);
+};
@@ -0,0 +1,131 @@
+#include "FFT.h"
+
+#include <cmath>
+#include <utility>
+
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+}
+
+void Fft::resize(std::size_t newSize)
+{
+    if (newSize == size)
+    {
+        return;
+    }
+    size = newSize;
+
+    twiddles.resize(size / 2);
+    for (std::size_t k = 0; k < size / 2; ++k)
+    {
+        twiddles[k] = std::polar(1.0, -2.0 * pi * static_cast<double>(k) / static_cast<double>(size));
+    }
+
+    int bits = 0;
+    while ((std::size_t(1) << bits) < size)
+    {
+        ++bits;
+    }
+    bitReversed.resize(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        std::uint32_t reversed = 0;
+        for (int bit = 0; bit < bits; ++bit)
+        {
+            reversed |= static_cast<std::uint32_t>((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        bitReversed[i] = reversed;
+    }
+}
+
+void Fft::transform(std::complex<double>* data, bool inverse) const
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        if (i < bitReversed[i])
+        {
+            std::swap(data[i], data[bitReversed[i]]);
+        }
+    }
+
+    //Iterative Cooley-Tukey butterflies, the twiddle for a block of length `length` is every (size / length)th one
+    for (std::size_t length = 2; length <= size; length *= 2)
+    {
+        std::size_t halfLength = length / 2;
+        std::size_t stride = size / length;
+        for (std::size_t start = 0; start < size; start += length)
+        {
+            for (std::size_t k = 0; k < halfLength; ++k)
+            {
+                std::complex<double> twiddle = twiddles[k * stride];
+                if (inverse)
+                {
+                    twiddle = std::conj(twiddle);
+                }
+                std::complex<double> odd = data[start + k + halfLength] * twiddle;
+                data[start + k + halfLength] = data[start + k] - odd;
+                data[start + k] += odd;
+            }
+        }
+    }
+}
+
+void RealFft::resize(std::size_t newSize)
+{
+    if (newSize == size)
+    {
+        return;
+    }
+    size = newSize;
+    half.resize(size / 2);
+
+    splitTwiddles.resize(size / 2 + 1);
+    for (std::size_t k = 0; k <= size / 2; ++k)
+    {
+        splitTwiddles[k] = std::polar(1.0, -2.0 * pi * static_cast<double>(k) / static_cast<double>(size));
+    }
+}
+
+void RealFft::realToComplex(const double* input, std::complex<double>* output, std::complex<double>* scratch) const
+{
+    //Even samples as the real parts, odd as the imaginary, then one half length transform does both at once
+    const std::size_t halfSize = size / 2;
+    for (std::size_t n = 0; n < halfSize; ++n)
+    {
+        scratch[n] = { input[2 * n], input[2 * n + 1] };
+    }
+    half.transform(scratch, false);
+
+    //Pull the even and odd transforms back apart and combine them: X[k] = E[k] + w^k O[k]
+    for (std::size_t k = 0; k <= halfSize; ++k)
+    {
+        std::complex<double> zk = scratch[k % halfSize];
+        std::complex<double> zMirror = std::conj(scratch[(halfSize - k) % halfSize]);
+        std::complex<double> even = (zk + zMirror) * 0.5;
+        std::complex<double> odd = (zk - zMirror) * std::complex<double>(0.0, -0.5);
+        output[k] = even + splitTwiddles[k] * odd;
+    }
+}
+
+void RealFft::complexToReal(const std::complex<double>* input, double* output, std::complex<double>* scratch) const
+{
+    //The same steps backwards: E[k] and O[k] from X[k] and X[halfSize - k], packed as E + iO
+    const std::size_t halfSize = size / 2;
+    for (std::size_t k = 0; k < halfSize; ++k)
+    {
+        std::complex<double> xk = input[k];
+        std::complex<double> xMirror = std::conj(input[halfSize - k]);
+        std::complex<double> even = (xk + xMirror) * 0.5;
+        std::complex<double> odd = (xk - xMirror) * 0.5 * std::conj(splitTwiddles[k]);
+        scratch[k] = even + std::complex<double>(0.0, 1.0) * odd;
+    }
+    half.transform(scratch, true);
+
+    const double scale = 1.0 / static_cast<double>(halfSize);
+    for (std::size_t n = 0; n < halfSize; ++n)
+    {
+        output[2 * n] = scratch[n].real() * scale;
+        output[2 * n + 1] = scratch[n].imag() * scale;
+    }
+}
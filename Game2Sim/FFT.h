@@ -0,0 +1,40 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Small radix-2 FFT bundled with the simulation, so the particle-mesh solver doesn't need an outside library.
+//Sizes have to be powers of two. Twiddle factors and the bit reversed order are worked out once per size.
+struct Fft
+{
+    std::size_t size = 0;
+    std::vector<std::complex<double>> twiddles; //e^(-2 pi i k / size) for k < size / 2
+    std::vector<std::uint32_t> bitReversed;
+
+public:
+    //Does nothing if it's already this size
+    void resize(std::size_t size);
+
+    //In place. The inverse leaves out the 1 / size, so callers can fold all the scaling into one multiply
+    void transform(std::complex<double>* data, bool inverse) const;
+};
+
+//Transform of `size` real values. Only the first size / 2 + 1 outputs are kept, the rest are their conjugates.
+//Done with one complex FFT of half the length, so it's about twice as fast as transforming the reals as complex numbers.
+struct RealFft
+{
+    std::size_t size = 0;
+    Fft half;
+    std::vector<std::complex<double>> splitTwiddles; //e^(-2 pi i k / size) for k <= size / 2
+
+public:
+    void resize(std::size_t size);
+
+    //scratch needs room for size / 2 values
+    void realToComplex(const double* input, std::complex<double>* output, std::complex<double>* scratch) const;
+
+    //Exact inverse of realToComplex, including the 1 / size scaling
+    void complexToReal(const std::complex<double>* input, double* output, std::complex<double>* scratch) const;
+};
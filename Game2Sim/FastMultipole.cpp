@@ -0,0 +1,545 @@
+#include "FastMultipole.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+    //The tree changes size every step, growing to double means a slowly growing tree only reallocates now and then
+    template <typename Vector>
+    void reserveGrowing(Vector& vector, std::size_t count)
+    {
+        if (vector.capacity() < count)
+        {
+            vector.reserve(std::max(count, vector.capacity() * 2));
+        }
+    }
+
+    //dx^i / i! for i <= order
+    void fillScaledPowers(double dx, int order, double* powers)
+    {
+        powers[0] = 1.0;
+        for (int i = 1; i <= order; ++i)
+        {
+            powers[i] = powers[i - 1] * dx / i;
+        }
+    }
+
+    //Every derivative d^(a+b) / dx^a dy^b of 1 / sqrt(x^2 + y^2 + softening2) with a + b <= order.
+    //Each comes from the two orders below it: with n = a + b and r^2 = x^2 + y^2 + softening2,
+    //n r^2 D(a,b) = -(2n - 1)(a x D(a-1,b) + b y D(a,b-1)) - (n - 1)(a (a-1) D(a-2,b) + b (b-1) D(a,b-2))
+    void fillDerivatives(double x, double y, double softening2, int order, int stride, double* derivatives)
+    {
+        const double distance2 = x * x + y * y + softening2;
+        const double inverse2 = 1.0 / distance2;
+        derivatives[0] = 1.0 / std::sqrt(distance2);
+
+        for (int n = 1; n <= order; ++n)
+        {
+            for (int a = 0; a <= n; ++a)
+            {
+                int b = n - a;
+                double first = 0.0;
+                if (a >= 1) first += a * x * derivatives[(a - 1) * stride + b];
+                if (b >= 1) first += b * y * derivatives[a * stride + b - 1];
+                double second = 0.0;
+                if (a >= 2) second += a * (a - 1) * derivatives[(a - 2) * stride + b];
+                if (b >= 2) second += b * (b - 1) * derivatives[a * stride + b - 2];
+                derivatives[a * stride + b] = -((2 * n - 1) * first + (n - 1) * second) * inverse2 / n;
+            }
+        }
+    }
+}
+
+void FastMultipoleTree::setOrder(int newOrder)
+{
+    order = std::clamp(newOrder, 1, maxOrder);
+    stride = order + 1;
+    termCount = stride * stride;
+}
+
+void FastMultipoleTree::build(const std::vector<Planet>& planets)
+{
+    cells.clear();
+    levelStart.clear();
+    sorted.resize(planets.size());
+    std::iota(sorted.begin(), sorted.end(), 0);
+
+    if (planets.empty())
+    {
+        return;
+    }
+
+    double minX = planets[0].position.x, maxX = minX;
+    double minY = planets[0].position.y, maxY = minY;
+    for (const Planet& planet : planets)
+    {
+        minX = std::min(minX, planet.position.x);
+        maxX = std::max(maxX, planet.position.x);
+        minY = std::min(minY, planet.position.y);
+        maxY = std::max(maxY, planet.position.y);
+    }
+
+    Cell root;
+    root.centerX = (minX + maxX) / 2.0;
+    root.centerY = (minY + maxY) / 2.0;
+    root.halfSize = std::max({ maxX - minX, maxY - minY, 1.0e-9 }) / 2.0;
+    root.begin = 0;
+    root.end = static_cast<int>(planets.size());
+    cells.push_back(root);
+
+    //Breadth first, every child of a level is added while that level is being split
+    std::size_t levelEnd = 0;
+    for (std::size_t cell = 0; cell < cells.size(); ++cell)
+    {
+        if (cell == levelEnd)
+        {
+            levelStart.push_back(static_cast<int>(cell));
+            levelEnd = cells.size();
+        }
+        int depth = static_cast<int>(levelStart.size()) - 1;
+        if (cells[cell].end - cells[cell].begin > leafSize && depth < maxDepth)
+        {
+            split(static_cast<int>(cell), planets);
+        }
+    }
+    levelStart.push_back(static_cast<int>(cells.size()));
+
+    x.resize(planets.size());
+    y.resize(planets.size());
+    mass.resize(planets.size());
+    for (std::size_t i = 0; i < sorted.size(); ++i)
+    {
+        const Planet& planet = planets[sorted[i]];
+        x[i] = planet.position.x;
+        y[i] = planet.position.y;
+        mass[i] = planet.mass;
+    }
+}
+
+void FastMultipoleTree::split(int cell, const std::vector<Planet>& planets)
+{
+    //Copy out of the cell first, push_back can reallocate
+    const Cell parent = cells[cell];
+    const double quarter = parent.halfSize / 2.0;
+
+    //Bottom half then top half, then each of those left then right
+    auto first = sorted.begin() + parent.begin;
+    auto last = sorted.begin() + parent.end;
+    auto middleY = std::partition(first, last, [&](int i) { return planets[i].position.y < parent.centerY; });
+    auto bottomX = std::partition(first, middleY, [&](int i) { return planets[i].position.x < parent.centerX; });
+    auto topX = std::partition(middleY, last, [&](int i) { return planets[i].position.x < parent.centerX; });
+
+    const std::vector<int>::iterator bounds[5] = { first, bottomX, middleY, topX, last };
+    cells[cell].firstChild = static_cast<int>(cells.size());
+    for (int quadrant = 0; quadrant < 4; ++quadrant)
+    {
+        if (bounds[quadrant] == bounds[quadrant + 1])
+        {
+            continue;
+        }
+        Cell child;
+        child.centerX = parent.centerX + ((quadrant & 1) ? quarter : -quarter);
+        child.centerY = parent.centerY + ((quadrant & 2) ? quarter : -quarter);
+        child.halfSize = quarter;
+        child.begin = static_cast<int>(bounds[quadrant] - sorted.begin());
+        child.end = static_cast<int>(bounds[quadrant + 1] - sorted.begin());
+        child.parent = cell;
+        cells.push_back(child);
+        ++cells[cell].childCount;
+    }
+}
+
+void FastMultipoleTree::buildInteractionLists()
+{
+    farPairs.clear();
+    nearPairs.clear();
+    traversalStack.clear();
+    traversalStack.push_back({ 0, 0 });
+    const double opening2 = openingRatio * openingRatio;
+
+    //Every (target, source) pair of cells is either close enough to split further or far enough to use expansions.
+    //Splitting a cell against itself makes both orders of every child pair, so each pair only has to go one way
+    while (!traversalStack.empty())
+    {
+        auto [target, source] = traversalStack.back();
+        traversalStack.pop_back();
+        const Cell& a = cells[target];
+        const Cell& b = cells[source];
+
+        if (target == source)
+        {
+            if (a.firstChild == -1)
+            {
+                nearPairs.push_back({ target, source });
+                continue;
+            }
+            for (int i = a.firstChild; i < a.firstChild + a.childCount; ++i)
+            {
+                for (int j = a.firstChild; j < a.firstChild + a.childCount; ++j)
+                {
+                    traversalStack.push_back({ i, j });
+                }
+            }
+            continue;
+        }
+
+        double dx = a.centerX - b.centerX;
+        double dy = a.centerY - b.centerY;
+        double reach = a.radius + b.radius;
+        if (reach * reach < opening2 * (dx * dx + dy * dy))
+        {
+            farPairs.push_back({ target, source });
+            continue;
+        }
+
+        bool targetLeaf = a.firstChild == -1;
+        bool sourceLeaf = b.firstChild == -1;
+        if (targetLeaf && sourceLeaf)
+        {
+            nearPairs.push_back({ target, source });
+        }
+        else if (sourceLeaf || (!targetLeaf && a.radius >= b.radius))
+        {
+            for (int i = a.firstChild; i < a.firstChild + a.childCount; ++i)
+            {
+                traversalStack.push_back({ i, source });
+            }
+        }
+        else
+        {
+            for (int j = b.firstChild; j < b.firstChild + b.childCount; ++j)
+            {
+                traversalStack.push_back({ target, j });
+            }
+        }
+    }
+
+    groupByTarget(farPairs, cells.size(), farStart, farSources);
+    groupByTarget(nearPairs, cells.size(), nearStart, nearSources);
+}
+
+void FastMultipoleTree::groupByTarget(const std::vector<std::pair<int, int>>& pairs, std::size_t cellCount,
+    std::vector<int>& start, std::vector<int>& sources)
+{
+    //Counting sort, sources keep their traversal order so the sums don't depend on the thread count
+    reserveGrowing(start, cellCount + 1);
+    start.assign(cellCount + 1, 0);
+    for (const auto& pair : pairs)
+    {
+        ++start[pair.first + 1];
+    }
+    for (std::size_t cell = 0; cell < cellCount; ++cell)
+    {
+        start[cell + 1] += start[cell];
+    }
+
+    reserveGrowing(sources, pairs.size());
+    sources.resize(pairs.size());
+    for (const auto& pair : pairs)
+    {
+        sources[start[pair.first]++] = pair.second;
+    }
+    //Each start was pushed up to the next cell's start, move them back
+    for (std::size_t cell = cellCount; cell > 0; --cell)
+    {
+        start[cell] = start[cell - 1];
+    }
+    start[0] = 0;
+}
+
+void FastMultipoleTree::leafToMultipole(int cell)
+{
+    Cell& leaf = cells[cell];
+    double* multipole = &multipoles[static_cast<std::size_t>(cell) * termCount];
+    double powersX[maxOrder + 1];
+    double powersY[maxOrder + 1];
+    double radius2 = 0.0;
+
+    for (int i = leaf.begin; i < leaf.end; ++i)
+    {
+        double dx = x[i] - leaf.centerX;
+        double dy = y[i] - leaf.centerY;
+        radius2 = std::max(radius2, dx * dx + dy * dy);
+
+        fillScaledPowers(-dx, order, powersX);
+        fillScaledPowers(-dy, order, powersY);
+        for (int a = 0; a <= order; ++a)
+        {
+            double massPower = mass[i] * powersX[a];
+            for (int b = 0; b <= order - a; ++b)
+            {
+                multipole[a * stride + b] += massPower * powersY[b];
+            }
+        }
+    }
+    leaf.radius = std::sqrt(radius2);
+}
+
+void FastMultipoleTree::gatherChildMultipoles(int cell, double* scratch)
+{
+    Cell& parent = cells[cell];
+    double* multipole = &multipoles[static_cast<std::size_t>(cell) * termCount];
+    double powersX[maxOrder + 1];
+    double powersY[maxOrder + 1];
+    double radius = 0.0;
+
+    for (int child = parent.firstChild; child < parent.firstChild + parent.childCount; ++child)
+    {
+        const Cell& from = cells[child];
+        double dx = from.centerX - parent.centerX;
+        double dy = from.centerY - parent.centerY;
+        radius = std::max(radius, std::sqrt(dx * dx + dy * dy) + from.radius);
+
+        //Shifting by d multiplies in (-d)^k / k! along each axis, so it's done as two 1D passes, y then x
+        const double* childMultipole = &multipoles[static_cast<std::size_t>(child) * termCount];
+        fillScaledPowers(-dx, order, powersX);
+        fillScaledPowers(-dy, order, powersY);
+        for (int a = 0; a <= order; ++a)
+        {
+            for (int b = 0; b <= order - a; ++b)
+            {
+                double sum = 0.0;
+                for (int j = 0; j <= b; ++j)
+                {
+                    sum += powersY[j] * childMultipole[a * stride + b - j];
+                }
+                scratch[a * stride + b] = sum;
+            }
+        }
+        for (int a = 0; a <= order; ++a)
+        {
+            for (int b = 0; b <= order - a; ++b)
+            {
+                double sum = 0.0;
+                for (int i = 0; i <= a; ++i)
+                {
+                    sum += powersX[i] * scratch[(a - i) * stride + b];
+                }
+                multipole[a * stride + b] += sum;
+            }
+        }
+    }
+    //Corners are the furthest anything can be, whatever the children say
+    parent.radius = std::min(radius, parent.halfSize * std::sqrt(2.0));
+}
+
+void FastMultipoleTree::multipolesToLocal(int target, double softening2, double* derivatives)
+{
+    const Cell& to = cells[target];
+    double* local = &locals[static_cast<std::size_t>(target) * termCount];
+
+    for (int k = farStart[target]; k < farStart[target + 1]; ++k)
+    {
+        const Cell& from = cells[farSources[k]];
+        const double* multipole = &multipoles[static_cast<std::size_t>(farSources[k]) * termCount];
+        fillDerivatives(to.centerX - from.centerX, to.centerY - from.centerY, softening2, order, stride, derivatives);
+
+        //Local (a, b) is the sum of multipole (i, j) times derivative (a + i, b + j), every run along j is contiguous
+        for (int a = 0; a <= order; ++a)
+        {
+            for (int b = 0; b <= order - a; ++b)
+            {
+                const int remaining = order - a - b;
+                double sum = 0.0;
+                for (int i = 0; i <= remaining; ++i)
+                {
+                    const double* multipoleRow = &multipole[i * stride];
+                    const double* derivativeRow = &derivatives[(a + i) * stride + b];
+                    for (int j = 0; j <= remaining - i; ++j)
+                    {
+                        sum += multipoleRow[j] * derivativeRow[j];
+                    }
+                }
+                local[a * stride + b] += sum;
+            }
+        }
+    }
+
+    //Potential is -G m / r, done once here rather than on every multipole
+    if (farStart[target] != farStart[target + 1])
+    {
+        for (int i = 0; i < termCount; ++i)
+        {
+            local[i] *= -G;
+        }
+    }
+}
+
+void FastMultipoleTree::parentLocalToChild(int cell, double* scratch)
+{
+    const Cell& child = cells[cell];
+    const Cell& parent = cells[child.parent];
+    const double* parentLocal = &locals[static_cast<std::size_t>(child.parent) * termCount];
+    double* local = &locals[static_cast<std::size_t>(cell) * termCount];
+    double powersX[maxOrder + 1];
+    double powersY[maxOrder + 1];
+
+    //Taylor series of every derivative out to the child's center, y then x like the multipole shift
+    fillScaledPowers(child.centerX - parent.centerX, order, powersX);
+    fillScaledPowers(child.centerY - parent.centerY, order, powersY);
+    for (int a = 0; a <= order; ++a)
+    {
+        for (int b = 0; b <= order - a; ++b)
+        {
+            double sum = 0.0;
+            for (int j = 0; j <= order - a - b; ++j)
+            {
+                sum += powersY[j] * parentLocal[a * stride + b + j];
+            }
+            scratch[a * stride + b] = sum;
+        }
+    }
+    for (int a = 0; a <= order; ++a)
+    {
+        for (int b = 0; b <= order - a; ++b)
+        {
+            double sum = 0.0;
+            for (int i = 0; i <= order - a - b; ++i)
+            {
+                sum += powersX[i] * scratch[(a + i) * stride + b];
+            }
+            local[a * stride + b] += sum;
+        }
+    }
+}
+
+void FastMultipoleTree::localToLeaf(int cell)
+{
+    const Cell& leaf = cells[cell];
+    const double* local = &locals[static_cast<std::size_t>(cell) * termCount];
+    double powersX[maxOrder + 1];
+    double powersY[maxOrder + 1];
+
+    for (int i = leaf.begin; i < leaf.end; ++i)
+    {
+        fillScaledPowers(x[i] - leaf.centerX, order, powersX);
+        fillScaledPowers(y[i] - leaf.centerY, order, powersY);
+
+        //Acceleration is minus the gradient of the potential, the gradient's series uses the derivatives one order up
+        double gradientX = 0.0;
+        double gradientY = 0.0;
+        for (int a = 0; a < order; ++a)
+        {
+            for (int b = 0; b < order - a; ++b)
+            {
+                double power = powersX[a] * powersY[b];
+                gradientX += power * local[(a + 1) * stride + b];
+                gradientY += power * local[a * stride + b + 1];
+            }
+        }
+        ax[i] -= gradientX;
+        ay[i] -= gradientY;
+    }
+}
+
+void FastMultipoleTree::nearField(int target, double softening2)
+{
+    if (nearStart[target] == nearStart[target + 1])
+    {
+        return;
+    }
+
+    const Cell& to = cells[target];
+    for (int i = to.begin; i < to.end; ++i)
+    {
+        double sumX = 0.0;
+        double sumY = 0.0;
+        for (int k = nearStart[target]; k < nearStart[target + 1]; ++k)
+        {
+            const Cell& from = cells[nearSources[k]];
+            for (int j = from.begin; j < from.end; ++j)
+            {
+                double rx = x[j] - x[i];
+                double ry = y[j] - y[i];
+                double distance2 = rx * rx + ry * ry;
+                if (distance2 == 0.0)
+                {
+                    continue;
+                }
+                double softened2 = distance2 + softening2;
+                double magnitude = G * mass[j] / (softened2 * std::sqrt(softened2));
+                sumX += rx * magnitude;
+                sumY += ry * magnitude;
+            }
+        }
+        ax[i] += sumX;
+        ay[i] += sumY;
+    }
+}
+
+void FastMultipoleTree::computeAccelerations(std::vector<Vector2d>& planetAccelerations, double softening2, ThreadPool& threadPool)
+{
+    if (cells.empty())
+    {
+        return;
+    }
+
+    const std::size_t expansionSize = cells.size() * termCount;
+    reserveGrowing(multipoles, expansionSize);
+    reserveGrowing(locals, expansionSize);
+    multipoles.assign(expansionSize, 0.0);
+    locals.assign(expansionSize, 0.0);
+    ax.assign(x.size(), 0.0);
+    ay.assign(x.size(), 0.0);
+    workerScratch.resize(static_cast<std::size_t>(threadPool.threadCount()) * termCount);
+    const int levels = static_cast<int>(levelStart.size()) - 1;
+
+    //Upward: leaves from their planets, then each parent from its children, deepest level first
+    for (int level = levels - 1; level >= 0; --level)
+    {
+        threadPool.parallelFor(levelStart[level + 1] - levelStart[level], 16, [&](std::size_t begin, std::size_t end, unsigned worker)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                int cell = levelStart[level] + static_cast<int>(i);
+                if (cells[cell].firstChild == -1) leafToMultipole(cell);
+                else gatherChildMultipoles(cell, &workerScratch[worker * termCount]);
+            }
+        });
+    }
+
+    //Needs every cell's radius, so it waits for the upward pass
+    buildInteractionLists();
+
+    //Every cell takes in its far sources' expansions, leaves also add up their near planets exactly
+    threadPool.parallelFor(cells.size(), 16, [&](std::size_t begin, std::size_t end, unsigned worker)
+    {
+        for (std::size_t cell = begin; cell < end; ++cell)
+        {
+            multipolesToLocal(static_cast<int>(cell), softening2, &workerScratch[worker * termCount]);
+            nearField(static_cast<int>(cell), softening2);
+        }
+    });
+
+    //Downward: each cell adds its parent's local expansion, leaves hand theirs to their planets
+    for (int level = 0; level < levels; ++level)
+    {
+        threadPool.parallelFor(levelStart[level + 1] - levelStart[level], 16, [&](std::size_t begin, std::size_t end, unsigned worker)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                int cell = levelStart[level] + static_cast<int>(i);
+                if (level > 0) parentLocalToChild(cell, &workerScratch[worker * termCount]);
+                if (cells[cell].firstChild == -1) localToLeaf(cell);
+            }
+        });
+    }
+
+    threadPool.parallelFor(sorted.size(), 1024, [&](std::size_t begin, std::size_t end, unsigned)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            planetAccelerations[sorted[i]] = { ax[i], ay[i] };
+        }
+    });
+}
+
+void computeFastMultipoleAccelerations(const std::vector<Planet>& planets, std::vector<Vector2d>& planetAccelerations,
+    FastMultipoleTree& tree, int order, double softening2, ThreadPool& threadPool)
+{
+    tree.setOrder(order);
+    tree.build(planets);
+    tree.computeAccelerations(planetAccelerations, softening2, threadPool);
+}
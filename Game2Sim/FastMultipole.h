@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Physics.h"
+#include "ThreadPool.h"
+#include <utility>
+#include <vector>
+
+//Fast multipole method: each quadtree cell gets a multipole expansion of the mass inside it, far apart cells
+//turn those straight into local expansions around each other, and each leaf evaluates its local expansion
+//at its planets. Near cells are summed exactly. Work is O(n) apart from sorting the planets into the tree.
+//
+//The expansions are Taylor series in x and y of the softened 1/r potential, the same one the direct sum uses,
+//so it works with any softening. (Complex power series only work for a log potential, which isn't this world's gravity.)
+//Error falls off roughly as openingRatio^(order + 1). Measured per planet against the direct sum on 20k planet disk,
+//Plummer and colliding cluster scenes: order 10 has a median of 1e-7 but its worst planets are off by up to 8e-5,
+//order 16 keeps every planet within 2e-7 (median 1e-10) for about 3x the time. Game2Bench --accuracy measures it for each order.
+struct FastMultipoleTree
+{
+    struct Cell
+    {
+        double centerX, centerY, halfSize; //Square bounds, expansions are taken about the center
+        double radius = 0.0;               //No planet in the cell is further than this from the center
+        int begin, end;                    //Planets in tree order
+        int parent = -1;
+        int firstChild = -1;               //Children are next to each other, -1 for a leaf
+        int childCount = 0;
+    };
+
+    static constexpr int maxOrder = 20;
+    static constexpr int leafSize = 32;
+    static constexpr int maxDepth = 32;
+
+    //Cells interact through their expansions once (radius A + radius B) < openingRatio * distance
+    double openingRatio = 0.4;
+
+    int order = -1;
+    int stride = 0;    //Coefficient (a, b) of x^a y^b is at a * stride + b, only a + b <= order is used
+    int termCount = 0; //stride * stride doubles per expansion
+
+    std::vector<Cell> cells;      //Built breadth first, so each level is one run of cells
+    std::vector<int> levelStart;  //Level k is cells [levelStart[k], levelStart[k + 1])
+    std::vector<int> sorted;      //Planet index of each tree position
+    std::vector<double> x, y, mass, ax, ay; //Planets in tree order
+    //termCount per cell. Multipoles are sum of m (-dx)^a (-dy)^b / (a! b!) over the planets, d measured from the center.
+    //Locals are the derivatives d^(a+b) potential / dx^a dy^b at the center. With both scaled like this every shift
+    //is a plain sum of products, with no binomials
+    std::vector<double> multipoles;
+    std::vector<double> locals;
+
+    //Who interacts with whom, grouped by the cell receiving
+    std::vector<std::pair<int, int>> farPairs, nearPairs; //(target, source), in traversal order
+    std::vector<int> farStart, farSources;
+    std::vector<int> nearStart, nearSources;
+    std::vector<std::pair<int, int>> traversalStack;
+    std::vector<double> workerScratch; //One expansion's worth for each pool thread
+
+public:
+    void setOrder(int order);
+    void build(const std::vector<Planet>& planets);
+    void computeAccelerations(std::vector<Vector2d>& planetAccelerations, double softening2, ThreadPool& threadPool);
+
+private:
+    void split(int cell, const std::vector<Planet>& planets);
+    void buildInteractionLists();
+    static void groupByTarget(const std::vector<std::pair<int, int>>& pairs, std::size_t cellCount,
+        std::vector<int>& start, std::vector<int>& sources);
+
+    void leafToMultipole(int cell);
+    void gatherChildMultipoles(int cell, double* scratch);
+    void multipolesToLocal(int target, double softening2, double* derivatives);
+    void parentLocalToChild(int cell, double* scratch);
+    void localToLeaf(int cell);
+    void nearField(int target, double softening2);
+};
+
+//Fills planetAccelerations like the other solvers. order is clamped to [1, FastMultipoleTree::maxOrder]
+void computeFastMultipoleAccelerations(const std::vector<Planet>& planets, std::vector<Vector2d>& planetAccelerations,
+    FastMultipoleTree& tree, int order, double softening2, ThreadPool& threadPool);
@@ -0,0 +1,213 @@
+#include "GravityKernel.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GAME2_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+//MSVC lets any function use AVX intrinsics, GCC and Clang need to be told per function
+#if defined(GAME2_X86) && !defined(_MSC_VER)
+#define GAME2_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define GAME2_TARGET_AVX2
+#endif
+
+const char* gravityKernelName(GravityKernel kernel)
+{
+    switch (kernel)
+    {
+    case GravityKernel::Sse: return "sse";
+    case GravityKernel::Avx2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+bool isGravityKernelSupported(GravityKernel kernel)
+{
+    if (kernel == GravityKernel::Scalar)
+    {
+        return true;
+    }
+
+#if defined(GAME2_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int highestLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+
+    if (kernel == GravityKernel::Sse)
+    {
+        return sse2;
+    }
+
+    bool avx2 = false;
+    if (highestLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+
+    //The OS also has to save the AVX registers on context switches
+    bool osSavesAvx = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+    return avx && avx2 && fma && osSavesAvx;
+#elif defined(GAME2_X86)
+    if (kernel == GravityKernel::Sse)
+    {
+        return __builtin_cpu_supports("sse2");
+    }
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+GravityKernel detectBestGravityKernel()
+{
+    if (isGravityKernelSupported(GravityKernel::Avx2)) return GravityKernel::Avx2;
+    if (isGravityKernelSupported(GravityKernel::Sse)) return GravityKernel::Sse;
+    return GravityKernel::Scalar;
+}
+
+//Planets at distance 0 (including the planet itself and the massless padding) are skipped, same as the old pair loop.
+//With softening on they'd add nothing anyway (dx = dy = 0), the skip is what keeps softening 0 from dividing by 0.
+static void directSumScalar(const BodyStore& bodies, std::vector<Vector2d>& planetAccelerations,
+    double softening2, std::size_t begin, std::size_t end)
+{
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const double xi = bodies.x[i];
+        const double yi = bodies.y[i];
+        double ax = 0.0;
+        double ay = 0.0;
+
+        for (std::size_t j = 0; j < bodies.paddedCount; ++j)
+        {
+            double dx = bodies.x[j] - xi;
+            double dy = bodies.y[j] - yi;
+            double distance2 = dx * dx + dy * dy;
+            if (distance2 == 0.0)
+            {
+                continue;
+            }
+            double softened2 = distance2 + softening2;
+            double scale = bodies.mass[j] / (softened2 * std::sqrt(softened2));
+            ax += dx * scale;
+            ay += dy * scale;
+        }
+
+        planetAccelerations[i] = { G * ax, G * ay };
+    }
+}
+
+#if defined(GAME2_X86)
+
+static double horizontalSum(__m128d v)
+{
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static void directSumSse(const BodyStore& bodies, std::vector<Vector2d>& planetAccelerations,
+    double softening2, std::size_t begin, std::size_t end)
+{
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d epsilon2 = _mm_set1_pd(softening2);
+
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const __m128d xi = _mm_set1_pd(bodies.x[i]);
+        const __m128d yi = _mm_set1_pd(bodies.y[i]);
+        __m128d ax = zero;
+        __m128d ay = zero;
+
+        for (std::size_t j = 0; j < bodies.paddedCount; j += 2)
+        {
+            __m128d dx = _mm_sub_pd(_mm_load_pd(&bodies.x[j]), xi);
+            __m128d dy = _mm_sub_pd(_mm_load_pd(&bodies.y[j]), yi);
+            __m128d distance2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+            __m128d softened2 = _mm_add_pd(distance2, epsilon2);
+            __m128d denominator = _mm_mul_pd(softened2, _mm_sqrt_pd(softened2));
+            __m128d scale = _mm_div_pd(_mm_load_pd(&bodies.mass[j]), denominator);
+            //Zero out the lanes where distance is 0 (0/0 or m/0 otherwise)
+            scale = _mm_and_pd(scale, _mm_cmpgt_pd(distance2, zero));
+            ax = _mm_add_pd(ax, _mm_mul_pd(dx, scale));
+            ay = _mm_add_pd(ay, _mm_mul_pd(dy, scale));
+        }
+
+        planetAccelerations[i] = { G * horizontalSum(ax), G * horizontalSum(ay) };
+    }
+}
+
+GAME2_TARGET_AVX2
+static double horizontalSum(__m256d v)
+{
+    __m128d low = _mm256_castpd256_pd128(v);
+    __m128d high = _mm256_extractf128_pd(v, 1);
+    return horizontalSum(_mm_add_pd(low, high));
+}
+
+GAME2_TARGET_AVX2
+static void directSumAvx2(const BodyStore& bodies, std::vector<Vector2d>& planetAccelerations,
+    double softening2, std::size_t begin, std::size_t end)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d epsilon2 = _mm256_set1_pd(softening2);
+
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const __m256d xi = _mm256_set1_pd(bodies.x[i]);
+        const __m256d yi = _mm256_set1_pd(bodies.y[i]);
+        __m256d ax = zero;
+        __m256d ay = zero;
+
+        for (std::size_t j = 0; j < bodies.paddedCount; j += 4)
+        {
+            __m256d dx = _mm256_sub_pd(_mm256_load_pd(&bodies.x[j]), xi);
+            __m256d dy = _mm256_sub_pd(_mm256_load_pd(&bodies.y[j]), yi);
+            __m256d distance2 = _mm256_fmadd_pd(dx, dx, _mm256_mul_pd(dy, dy));
+            __m256d softened2 = _mm256_add_pd(distance2, epsilon2);
+            __m256d denominator = _mm256_mul_pd(softened2, _mm256_sqrt_pd(softened2));
+            __m256d scale = _mm256_div_pd(_mm256_load_pd(&bodies.mass[j]), denominator);
+            scale = _mm256_and_pd(scale, _mm256_cmp_pd(distance2, zero, _CMP_GT_OQ));
+            ax = _mm256_fmadd_pd(dx, scale, ax);
+            ay = _mm256_fmadd_pd(dy, scale, ay);
+        }
+
+        planetAccelerations[i] = { G * horizontalSum(ax), G * horizontalSum(ay) };
+    }
+}
+
+#endif
+
+void computeDirectSumAccelerations(const BodyStore& bodies, std::vector<Vector2d>& planetAccelerations,
+    GravityKernel kernel, double softening2, std::size_t begin, std::size_t end)
+{
+#if defined(GAME2_X86)
+    if (kernel == GravityKernel::Avx2)
+    {
+        directSumAvx2(bodies, planetAccelerations, softening2, begin, end);
+        return;
+    }
+    if (kernel == GravityKernel::Sse)
+    {
+        directSumSse(bodies, planetAccelerations, softening2, begin, end);
+        return;
+    }
+#endif
+    directSumScalar(bodies, planetAccelerations, softening2, begin, end);
+}
+
+void computeDirectSumAccelerations(const BodyStore& bodies, std::vector<Vector2d>& planetAccelerations,
+    GravityKernel kernel, double softening2)
+{
+    computeDirectSumAccelerations(bodies, planetAccelerations, kernel, softening2, 0, bodies.count);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "BodyStore.h"
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+
+//Instruction sets the direct sum gravity loop can run on
+enum class GravityKernel
+{
+    Scalar, //Plain C++, works everywhere
+    Sse,    //2 planets per instruction
+    Avx2    //4 planets per instruction
+};
+
+const char* gravityKernelName(GravityKernel kernel);
+
+//Checks what the CPU running the game supports, not what it was compiled for
+bool isGravityKernelSupported(GravityKernel kernel);
+GravityKernel detectBestGravityKernel();
+
+//Direct sum acceleration for planets [begin, end) from every planet in the store, Plummer softened by softening2 (m^2).
+//Each planet's sum runs over the others in index order, so the result doesn't depend on how the range is split up.
+void computeDirectSumAccelerations(const BodyStore& bodies, std::vector<Vector2d>& planetAccelerations,
+    GravityKernel kernel, double softening2, std::size_t begin, std::size_t end);
+
+void computeDirectSumAccelerations(const BodyStore& bodies, std::vector<Vector2d>& planetAccelerations,
+    GravityKernel kernel, double softening2);
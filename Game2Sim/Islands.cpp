@@ -0,0 +1,220 @@
+#include "Islands.h"
+
+#include "Collision.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    constexpr std::uint8_t hasContact = 1; //More than one planet in the island
+    constexpr std::uint8_t touched = 2;    //Sleeping island that an awake planet touched this step
+
+    bool touching(const Planet& p1, const Planet& p2)
+    {
+        Vector2d d = p2.position - p1.position;
+        double minDist = p1.radius + p2.radius;
+        return dot(d, d) <= minDist * minDist;
+    }
+}
+
+void ContactIslands::resolve(std::vector<Planet>& planets, UniformGrid& collisionGrid, const SleepSettings& settings)
+{
+    group.resize(planets.size());
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        group[i] = static_cast<std::uint32_t>(i);
+    }
+    sleepingIsland.resize(planets.size());
+    sleepingSupport.resize(planets.size());
+    sleepingDrift.resize(planets.size());
+    supportKnown.resize(planets.size());
+    islandState.assign(planets.size(), 0);
+
+    //Islands are built from the awake planets touching before anything is solved. Anything awake touching a sleeping
+    //planet wakes its whole island, the pile has been disturbed
+    const std::vector<UniformGrid::PlanetPair>& pairs = collisionGrid.findCandidatePairs(planets, true);
+    for (const UniformGrid::PlanetPair& pair : pairs)
+    {
+        const Planet& p1 = planets[pair.first];
+        const Planet& p2 = planets[pair.second];
+        if (!touching(p1, p2))
+        {
+            continue;
+        }
+
+        if (p1.asleep || p2.asleep)
+        {
+            islandState[sleepingIsland[p1.asleep ? pair.first : pair.second]] |= touched;
+            continue;
+        }
+
+        std::uint32_t a = findGroup(group, pair.first);
+        std::uint32_t b = findGroup(group, pair.second);
+        if (a != b)
+        {
+            group[std::max(a, b)] = std::min(a, b);
+        }
+    }
+
+    //Flatten so group[i] is the root for every planet from here on
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        group[i] = findGroup(group, static_cast<std::uint32_t>(i));
+    }
+
+    //Woken planets are on their own until next step, when their contacts with each other are found again
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        if (planets[i].asleep && (islandState[sleepingIsland[i]] & touched))
+        {
+            planets[i].asleep = false;
+            planets[i].quietSteps = 0;
+        }
+    }
+
+    //Goes over the candidate pairs again rather than only the ones touching before solving, so pairs pushed into
+    //contact by an earlier pair count too, exactly like resolvePlanetCollisions
+    for (const UniformGrid::PlanetPair& pair : pairs)
+    {
+        Planet& p1 = planets[pair.first];
+        Planet& p2 = planets[pair.second];
+        //Only left asleep if it was pushed into during this pass, it wakes next step
+        if (p1.asleep || p2.asleep || !touching(p1, p2))
+        {
+            continue;
+        }
+
+        doPlanetPlanetCollision(p1, p2);
+        preventSinking(p1, p2);
+    }
+
+    updateSleep(planets, settings);
+}
+
+void ContactIslands::updateSleep(std::vector<Planet>& planets, const SleepSettings& settings)
+{
+    islandState.assign(planets.size(), 0);
+    islandMass.assign(planets.size(), 0.0);
+    islandEnergy.assign(planets.size(), 0.0);
+    islandMomentum.assign(planets.size(), { 0.0, 0.0 });
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        const Planet& planet = planets[i];
+        islandMass[group[i]] += planet.mass;
+        islandEnergy[group[i]] += 0.5 * planet.mass * dot(planet.velocity, planet.velocity);
+        islandMomentum[group[i]] += planet.velocity * planet.mass;
+
+        //A planet on its own has nothing holding it still, only real islands (a root with other members) can sleep
+        if (group[i] != i)
+        {
+            islandState[group[i]] |= hasContact;
+        }
+    }
+
+    islandQuiet.assign(planets.size(), std::numeric_limits<std::uint16_t>::max());
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        Planet& planet = planets[i];
+        std::uint32_t root = group[i];
+        double mass = islandMass[root];
+        //Energy of the planets moving about inside the island, what's left after taking out the island moving as a whole
+        double internalEnergy = mass > 0.0 ? islandEnergy[root] - 0.5 * dot(islandMomentum[root], islandMomentum[root]) / mass : 0.0;
+        bool quiet = !planet.asleep && (islandState[root] & hasContact) && mass > 0.0 && internalEnergy / mass < settings.energyThreshold;
+
+        planet.quietSteps = quiet ? static_cast<std::uint16_t>(std::min<int>(planet.quietSteps + 1, settings.quietStepsToSleep)) : 0;
+        islandQuiet[root] = std::min(islandQuiet[root], planet.quietSteps);
+    }
+
+    //Members that joined the island recently hold the rest of it awake until they've been still long enough too.
+    //Everyone takes the island's mean velocity, so it moves as one piece and keeps its momentum
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        Planet& planet = planets[i];
+        if (!planet.asleep && settings.quietStepsToSleep > 0 && islandQuiet[group[i]] >= settings.quietStepsToSleep)
+        {
+            planet.asleep = true;
+            planet.velocity = islandMomentum[group[i]] / islandMass[group[i]];
+            sleepingIsland[i] = group[i];
+            sleepingDrift[i] = { 0.0, 0.0 };
+            supportKnown[i] = 0;
+        }
+    }
+}
+
+void ContactIslands::kickSleeping(std::vector<Planet>& planets, const std::vector<Vector2d>& accelerations, double deltaTime, const SleepSettings& settings)
+{
+    //Only the roots of sleeping islands are touched, so an awake world only pays for the one pass looking for them
+    sleepingMass.resize(planets.size());
+    sleepingPull.resize(planets.size());
+    sleepingStrain.resize(planets.size());
+    bool anyAsleep = false;
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        if (planets[i].asleep)
+        {
+            sleepingMass[sleepingIsland[i]] = 0.0;
+            sleepingPull[sleepingIsland[i]] = { 0.0, 0.0 };
+            sleepingStrain[sleepingIsland[i]] = 0.0;
+            anyAsleep = true;
+        }
+    }
+    if (!anyAsleep)
+    {
+        return;
+    }
+
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        if (planets[i].asleep)
+        {
+            sleepingMass[sleepingIsland[i]] += planets[i].mass;
+            sleepingPull[sleepingIsland[i]] += accelerations[i] * planets[i].mass;
+        }
+    }
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        if (planets[i].asleep)
+        {
+            std::uint32_t root = sleepingIsland[i];
+            Vector2d meanAcceleration = sleepingPull[root] / sleepingMass[root];
+            planets[i].velocity += meanAcceleration * deltaTime;
+
+            //Whatever pulled this planet away from the rest when it fell asleep is what its contacts hold back.
+            //Both that and the relative pull sum to zero over the island, weighted by mass, so the drift never moves the island
+            Vector2d relativeAcceleration = accelerations[i] - meanAcceleration;
+            if (!supportKnown[i])
+            {
+                sleepingSupport[i] = relativeAcceleration;
+                supportKnown[i] = 1;
+            }
+            sleepingDrift[i] += (relativeAcceleration - sleepingSupport[i]) * deltaTime;
+            sleepingStrain[root] += 0.5 * planets[i].mass * dot(sleepingDrift[i], sleepingDrift[i]);
+        }
+    }
+
+    //Same measure as falling asleep, woken planets take the velocities they were held back from
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        if (planets[i].asleep && sleepingStrain[sleepingIsland[i]] / sleepingMass[sleepingIsland[i]] >= settings.energyThreshold)
+        {
+            planets[i].asleep = false;
+            planets[i].quietSteps = 0;
+            planets[i].velocity += sleepingDrift[i];
+        }
+    }
+}
+
+void ContactIslands::wakeAll(std::vector<Planet>& planets)
+{
+    for (Planet& planet : planets)
+    {
+        planet.asleep = false;
+        planet.quietSteps = 0;
+    }
+}
+
+std::size_t ContactIslands::countAsleep(const std::vector<Planet>& planets)
+{
+    return static_cast<std::size_t>(std::count_if(planets.begin(), planets.end(), [](const Planet& planet) { return planet.asleep; }));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Broadphase.h"
+#include "Physics.h"
+#include <cstdint>
+#include <vector>
+
+//When planets in a resting pile are allowed to sleep
+struct SleepSettings
+{
+    double energyThreshold = 1.0e-3; //Kinetic energy per kg (J/kg) of an island relative to its own motion, 1e-3 is everyone at about 4.5 cm/s
+    int quietStepsToSleep = 60;      //Steps in a row an island has to stay under the threshold, about a second at 60 steps/sec
+};
+
+//Bounce mode collisions that let settled piles sleep.
+//Planets that touch are joined into contact islands every step. An island of two or more planets that stays nearly still
+//for long enough is put to sleep: its planets stop moving and pairs inside it aren't even looked at by the broadphase,
+//so a big settled pile costs next to nothing. The whole island wakes as soon as an awake planet touches any of it.
+//A sleeping island moves as one rigid body: it keeps its momentum when it falls asleep and is pulled by the mean
+//gravity on its planets, so a pile falling or orbiting through space carries on doing so while it sleeps.
+//Only motion inside the island counts towards the threshold, a pile moving as one can sleep at any speed.
+//While asleep, each planet keeps track of how the pull on it has changed since it fell asleep, relative to the rest of
+//the island. The pile's own weight is already held up by its contacts, but a planet passing close by pulls harder on
+//one side. Once the velocities that would have given the planets inside the island reach the threshold, it wakes with them.
+struct ContactIslands
+{
+    std::vector<std::uint32_t> group;          //Union-find parent over the awake planets, one island per root
+    std::vector<std::uint32_t> sleepingIsland; //Root of the island a sleeping planet fell asleep in
+    std::vector<std::uint8_t> islandState;     //Per root, whether it has more than one planet and whether it's been touched
+    std::vector<double> islandMass;            //Per root
+    std::vector<double> islandEnergy;          //Per root, kinetic energy after the collisions were solved
+    std::vector<std::uint16_t> islandQuiet;    //Per root, fewest quiet steps of any member
+    std::vector<Vector2d> islandMomentum;      //Per root
+    std::vector<double> sleepingMass;          //Per sleeping island root, for kickSleeping
+    std::vector<Vector2d> sleepingPull;        //Per sleeping island root, sum of mass * acceleration
+    std::vector<double> sleepingStrain;        //Per sleeping island root, kinetic energy of the planets' sleepingDrift
+    std::vector<Vector2d> sleepingSupport;     //Per sleeping planet, its pull minus the island's mean pull on its first kick asleep
+    std::vector<Vector2d> sleepingDrift;       //Per sleeping planet, velocity it has been held back from since then
+    std::vector<std::uint8_t> supportKnown;    //Per sleeping planet, whether sleepingSupport has been filled in yet
+
+public:
+    //Same response as resolvePlanetCollisions, for everything that isn't asleep, then updates who sleeps.
+    //Sleeping islands are remembered by planet index, so wake everything (wakeAll) before planets are removed or reordered
+    void resolve(std::vector<Planet>& planets, UniformGrid& collisionGrid, const SleepSettings& settings);
+
+    //The kick for sleeping planets: each sleeping island gets the mass weighted mean of its planets' accelerations,
+    //the forces inside the pile cancel out and only the pull from outside moves it.
+    //Wakes any island whose change in pull across it has built up past the energy threshold
+    void kickSleeping(std::vector<Planet>& planets, const std::vector<Vector2d>& accelerations, double deltaTime, const SleepSettings& settings);
+
+    static void wakeAll(std::vector<Planet>& planets);
+
+    //Planets asleep right now, for headless output
+    static std::size_t countAsleep(const std::vector<Planet>& planets);
+
+private:
+    void updateSleep(std::vector<Planet>& planets, const SleepSettings& settings);
+};
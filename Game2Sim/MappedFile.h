@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//Read only view of a whole file mapped into memory, so a big file is paged straight in by the OS as it's read
+//rather than copied through a stream buffer first. The view stays valid until close() or the MappedFile goes away.
+struct MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //Returns false if the file can't be opened or mapped. An empty file opens with size() 0 and no data
+    bool open(const std::string& path);
+    void close();
+
+    const unsigned char* data() const { return view; }
+    std::size_t size() const { return length; }
+
+private:
+    const unsigned char* view = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;    //HANDLE, kept as void* so windows.h stays out of the header
+    void* mappingHandle = nullptr;
+#else
+    int descriptor = -1;
+#endif
+};
@@ -0,0 +1,249 @@
+#include "ParticleMesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    //Cloud-in-cell: a planet is a cell sized square, its mass goes to the 4 cells that square overlaps.
+    //Grid values sit at cell centers, hence the half cell shift
+    struct CellWeights
+    {
+        std::size_t x, y;  //Lower left of the 4 cells
+        double wx, wy;     //Share that goes to x + 1 and y + 1
+    };
+
+    CellWeights cellWeights(const Vector2d& position, const Vector2d& origin, double cellSize)
+    {
+        double u = (position.x - origin.x) / cellSize - 0.5;
+        double v = (position.y - origin.y) / cellSize - 0.5;
+        double cellX = std::floor(u);
+        double cellY = std::floor(v);
+        return { static_cast<std::size_t>(cellX), static_cast<std::size_t>(cellY), u - cellX, v - cellY };
+    }
+}
+
+void computeParticleMeshAccelerations(const std::vector<Planet>& planets, std::vector<Vector2d>& planetAccelerations,
+    ParticleMesh& mesh, std::size_t gridSize, double softening2, ThreadPool& threadPool)
+{
+    mesh.compute(planets, planetAccelerations, gridSize, softening2, threadPool);
+}
+
+void ParticleMesh::compute(const std::vector<Planet>& planets, std::vector<Vector2d>& planetAccelerations,
+    std::size_t requestedGridSize, double softening2, ThreadPool& threadPool)
+{
+    if (planets.empty())
+    {
+        return;
+    }
+
+    placeGrid(planets, requestedGridSize, softening2, threadPool);
+    deposit(planets);
+    forwardTransform(density, spectrum, threadPool);
+
+    //Convolution is a multiply in frequency space, once per acceleration component
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        const std::vector<std::complex<double>>& kernel = axis == 0 ? kernelSpectrumX : kernelSpectrumY;
+        threadPool.parallelFor(spectrum.size(), 4096, [&](std::size_t begin, std::size_t end, unsigned)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                product[i] = spectrum[i] * kernel[i];
+            }
+        });
+        inverseTransform(product, axis == 0 ? accelerationX : accelerationY, threadPool);
+    }
+
+    //Read back with the same weights the mass went out with, so a planet doesn't pull on itself
+    threadPool.parallelFor(planets.size(), 1024, [&](std::size_t begin, std::size_t end, unsigned)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            CellWeights cell = cellWeights(planets[i].position, origin, cellSize);
+            std::size_t index = cell.y * paddedSize + cell.x;
+            double w00 = (1.0 - cell.wx) * (1.0 - cell.wy);
+            double w10 = cell.wx * (1.0 - cell.wy);
+            double w01 = (1.0 - cell.wx) * cell.wy;
+            double w11 = cell.wx * cell.wy;
+
+            auto sample = [&](const std::vector<double>& grid)
+            {
+                return w00 * grid[index] + w10 * grid[index + 1] + w01 * grid[index + paddedSize] + w11 * grid[index + paddedSize + 1];
+            };
+            planetAccelerations[i] = { sample(accelerationX), sample(accelerationY) };
+        }
+    });
+}
+
+std::size_t ParticleMesh::roundGridSize(std::size_t requestedGridSize)
+{
+    std::size_t size = 16;
+    while (size < requestedGridSize)
+    {
+        size *= 2;
+    }
+    return size;
+}
+
+double ParticleMesh::cellSizeFor(double extent, std::size_t requestedGridSize)
+{
+    //Two spare cells on each side keep every planet's 4 cells inside the grid
+    double wanted = std::max(extent, 1.0e-6) / static_cast<double>(roundGridSize(requestedGridSize) - 4);
+    return std::exp2(std::ceil(std::log2(wanted)));
+}
+
+void ParticleMesh::placeGrid(const std::vector<Planet>& planets, std::size_t requestedGridSize, double softening2, ThreadPool& threadPool)
+{
+    std::size_t size = roundGridSize(requestedGridSize);
+    if (size != gridSize)
+    {
+        gridSize = size;
+        paddedSize = 2 * size;
+        cellSize = 0.0; //Kernels have to be rebuilt for the new size
+
+        std::size_t spectrumSize = paddedSize * (paddedSize / 2 + 1);
+        density.assign(paddedSize * paddedSize, 0.0);
+        accelerationX.assign(paddedSize * paddedSize, 0.0);
+        accelerationY.assign(paddedSize * paddedSize, 0.0);
+        spectrum.assign(spectrumSize, {});
+        product.assign(spectrumSize, {});
+        kernelSpectrumX.assign(spectrumSize, {});
+        kernelSpectrumY.assign(spectrumSize, {});
+        rowFft.resize(paddedSize);
+        columnFft.resize(paddedSize);
+    }
+    workerScratch.resize(threadPool.threadCount());
+    for (std::vector<std::complex<double>>& scratch : workerScratch)
+    {
+        scratch.resize(paddedSize);
+    }
+
+    double minX = planets[0].position.x, maxX = minX;
+    double minY = planets[0].position.y, maxY = minY;
+    for (const Planet& planet : planets)
+    {
+        minX = std::min(minX, planet.position.x);
+        maxX = std::max(maxX, planet.position.x);
+        minY = std::min(minY, planet.position.y);
+        maxY = std::max(maxY, planet.position.y);
+    }
+
+    double newCellSize = cellSizeFor(std::max(maxX - minX, maxY - minY), gridSize);
+
+    //Snapped to whole cells, so a planet standing still deposits the same way every step
+    origin.x = std::floor(minX / newCellSize) * newCellSize - 2.0 * newCellSize;
+    origin.y = std::floor(minY / newCellSize) * newCellSize - 2.0 * newCellSize;
+
+    if (newCellSize != cellSize || softening2 != kernelSoftening2)
+    {
+        cellSize = newCellSize;
+        kernelSoftening2 = softening2;
+        buildKernels(softening2, threadPool);
+    }
+}
+
+void ParticleMesh::buildKernels(double softening2, ThreadPool& threadPool)
+{
+    //Acceleration at offset (dx, dy) from a unit mass, -G d / (|d|^2 + eps^2)^1.5, laid out with negative offsets
+    //wrapped to the far end so the circular convolution sees them. Offsets of exactly gridSize can't happen, left 0
+    std::vector<double>& kernelX = accelerationX;
+    std::vector<double>& kernelY = accelerationY;
+    for (std::size_t row = 0; row < paddedSize; ++row)
+    {
+        for (std::size_t column = 0; column < paddedSize; ++column)
+        {
+            std::size_t index = row * paddedSize + column;
+            if (row == gridSize || column == gridSize)
+            {
+                kernelX[index] = 0.0;
+                kernelY[index] = 0.0;
+                continue;
+            }
+
+            double dx = (column < gridSize ? static_cast<double>(column) : static_cast<double>(column) - paddedSize) * cellSize;
+            double dy = (row < gridSize ? static_cast<double>(row) : static_cast<double>(row) - paddedSize) * cellSize;
+            double softened2 = dx * dx + dy * dy + softening2;
+            double magnitude = softened2 > 0.0 ? -G / (softened2 * std::sqrt(softened2)) : 0.0;
+            kernelX[index] = dx * magnitude;
+            kernelY[index] = dy * magnitude;
+        }
+    }
+
+    forwardTransform(kernelX, kernelSpectrumX, threadPool);
+    forwardTransform(kernelY, kernelSpectrumY, threadPool);
+}
+
+void ParticleMesh::deposit(const std::vector<Planet>& planets)
+{
+    //Only the top left gridSize x gridSize corner ever gets mass, the rest stays 0 as padding
+    for (std::size_t row = 0; row < gridSize; ++row)
+    {
+        std::fill_n(density.begin() + row * paddedSize, gridSize, 0.0);
+    }
+
+    for (const Planet& planet : planets)
+    {
+        CellWeights cell = cellWeights(planet.position, origin, cellSize);
+        std::size_t index = cell.y * paddedSize + cell.x;
+        density[index] += planet.mass * (1.0 - cell.wx) * (1.0 - cell.wy);
+        density[index + 1] += planet.mass * cell.wx * (1.0 - cell.wy);
+        density[index + paddedSize] += planet.mass * (1.0 - cell.wx) * cell.wy;
+        density[index + paddedSize + 1] += planet.mass * cell.wx * cell.wy;
+    }
+}
+
+void ParticleMesh::forwardTransform(const std::vector<double>& grid, std::vector<std::complex<double>>& output, ThreadPool& threadPool)
+{
+    const std::size_t rowLength = paddedSize / 2 + 1;
+    threadPool.parallelFor(paddedSize, 8, [&](std::size_t begin, std::size_t end, unsigned worker)
+    {
+        for (std::size_t row = begin; row < end; ++row)
+        {
+            rowFft.realToComplex(&grid[row * paddedSize], &output[row * rowLength], workerScratch[worker].data());
+        }
+    });
+    transformColumns(output, false, threadPool);
+}
+
+void ParticleMesh::inverseTransform(std::vector<std::complex<double>>& input, std::vector<double>& grid, ThreadPool& threadPool)
+{
+    transformColumns(input, true, threadPool);
+
+    //Column transforms leave out their 1 / paddedSize, the row transform already scales itself
+    const std::size_t rowLength = paddedSize / 2 + 1;
+    const double scale = 1.0 / static_cast<double>(paddedSize);
+    threadPool.parallelFor(gridSize, 8, [&](std::size_t begin, std::size_t end, unsigned worker)
+    {
+        for (std::size_t row = begin; row < end; ++row)
+        {
+            for (std::size_t k = 0; k < rowLength; ++k)
+            {
+                input[row * rowLength + k] *= scale;
+            }
+            rowFft.complexToReal(&input[row * rowLength], &grid[row * paddedSize], workerScratch[worker].data());
+        }
+    });
+}
+
+void ParticleMesh::transformColumns(std::vector<std::complex<double>>& data, bool inverse, ThreadPool& threadPool)
+{
+    //Each column is copied out to be contiguous, transformed, and copied back
+    const std::size_t rowLength = paddedSize / 2 + 1;
+    threadPool.parallelFor(rowLength, 4, [&](std::size_t begin, std::size_t end, unsigned worker)
+    {
+        std::complex<double>* column = workerScratch[worker].data();
+        for (std::size_t k = begin; k < end; ++k)
+        {
+            for (std::size_t row = 0; row < paddedSize; ++row)
+            {
+                column[row] = data[row * rowLength + k];
+            }
+            columnFft.transform(column, inverse);
+            for (std::size_t row = 0; row < paddedSize; ++row)
+            {
+                data[row * rowLength + k] = column[row];
+            }
+        }
+    });
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "FFT.h"
+#include "Physics.h"
+#include "ThreadPool.h"
+#include <complex>
+#include <vector>
+
+//Particle-mesh gravity: mass is spread onto a square grid with cloud-in-cell weights, the grid is convolved with the
+//softened 1/r^2 force by FFT, and each planet reads its acceleration back off the grid with the same weights.
+//The cost is O(n + g^2 log g) for a g x g grid whatever the planets do, so it suits huge, fairly even distributions.
+//Forces closer than a couple of cells are smoothed out, so it's not the solver for tight clusters or collisions.
+//Needs the softening to be at least about one cell, anything closer than that is lost. On the 20k planet disk scenario
+//with a 256 grid (6.25 cm cells) the rms force error is 40% at the default 2.5 cm softening, 8% at one cell and 1.4% at two.
+//The grid is zero padded to twice its size, so there is no wraparound between opposite edges (isolated, not periodic).
+struct ParticleMesh
+{
+    std::size_t gridSize = 0;   //Cells per side over the planets
+    std::size_t paddedSize = 0; //Cells per side of the transforms, 2 * gridSize
+    double cellSize = 0.0;      //Meters, a power of two so it only changes when the planets spread a lot further
+    double kernelSoftening2 = -1.0;
+    Vector2d origin;            //World position of the corner of cell (0, 0)
+
+    std::vector<double> density;                      //Mass per cell, paddedSize^2
+    std::vector<std::complex<double>> spectrum;       //paddedSize rows of paddedSize / 2 + 1
+    std::vector<std::complex<double>> kernelSpectrumX; //Transforms of the force per unit mass, only redone when cellSize changes
+    std::vector<std::complex<double>> kernelSpectrumY;
+    std::vector<std::complex<double>> product;
+    std::vector<double> accelerationX, accelerationY; //paddedSize^2, only the first gridSize rows and columns mean anything
+    std::vector<std::vector<std::complex<double>>> workerScratch;
+
+    RealFft rowFft;
+    Fft columnFft;
+
+public:
+    //Cells per side actually used for a requested size, the next power of two from 16 up
+    static std::size_t roundGridSize(std::size_t requestedGridSize);
+    //Cell size compute() picks for planets spread over extent meters (the wider of the x and y spans)
+    static double cellSizeFor(double extent, std::size_t requestedGridSize);
+
+    void compute(const std::vector<Planet>& planets, std::vector<Vector2d>& planetAccelerations,
+        std::size_t requestedGridSize, double softening2, ThreadPool& threadPool);
+
+private:
+    void placeGrid(const std::vector<Planet>& planets, std::size_t requestedGridSize, double softening2, ThreadPool& threadPool);
+    void buildKernels(double softening2, ThreadPool& threadPool);
+    void deposit(const std::vector<Planet>& planets);
+
+    void forwardTransform(const std::vector<double>& grid, std::vector<std::complex<double>>& output, ThreadPool& threadPool);
+    //Destroys input. Only the first gridSize rows come out, the rest aren't needed
+    void inverseTransform(std::vector<std::complex<double>>& input, std::vector<double>& grid, ThreadPool& threadPool);
+    void transformColumns(std::vector<std::complex<double>>& data, bool inverse, ThreadPool& threadPool);
+};
+
+//Fills planetAccelerations like the other solvers. gridSize is rounded up to a power of two (at least 16)
+void computeParticleMeshAccelerations(const std::vector<Planet>& planets, std::vector<Vector2d>& planetAccelerations,
+    ParticleMesh& mesh, std::size_t gridSize, double softening2, ThreadPool& threadPool);
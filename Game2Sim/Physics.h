@@ -0,0 +1,95 @@
+#pragma once
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+//Simulation units are SI: meters, seconds and kilograms. Only drawing and mouse input deal in pixels,
+//and they go through an sf::View scaled by pixels_per_meter so the physics never sees a pixel.
+
+//Simulation state is all double, floats are only used for drawing (see RenderPlanet)
+using Vector2d = sf::Vector2<double>;
+
+//Stores information about planets, used for gravity calculations and movement.
+struct Planet
+{
+    Vector2d position; //Meters
+    double radius;     //Meters
+    double mass; //MASS IN KG
+    Vector2d velocity; //Meters per second
+    sf::Color color = sf::Color(rand() % 256, rand() % 256, rand() % 256);
+
+    //Only used when sleeping is turned on (see ContactIslands)
+    std::uint16_t quietSteps = 0; //Steps in a row its contact island has been nearly still
+    bool asleep = false;          //Moves with its island as one piece and left out of collisions until something wakes the island
+};
+
+//Float copy of what the renderer needs from a planet, written by the World after every step
+struct RenderPlanet
+{
+    sf::Vector2f position;
+    sf::Vector2f previousPosition; //Before the last step, for drawing in between two steps
+    float radius;
+    sf::Color color;
+};
+
+constexpr double G = 6.6743e-11; //m^3 kg^-1 s^-2
+
+//Plummer softening: gravity acts as if every distance had this added in quadrature, G*m*r / (r^2 + eps^2)^1.5.
+//Stops planets that pass very close from getting huge accelerations. Half a small planet's radius.
+constexpr double softeningLength = 0.025;  // (meters)
+constexpr double softening2 = softeningLength * softeningLength; // (meters^2)
+
+//1 pixel is 1 cm at zoom 1. With 1e10 kg planets this gives the same motion the game had when it
+//treated pixels as meters and milliseconds as seconds.
+constexpr double pixels_per_meter = 100.0;
+inline double metersPerPixel() { return 1.0 / pixels_per_meter; }
+
+//Function that divides a vector by a scalars
+inline Vector2d divideVectorByDouble(Vector2d v1, double scalar) {
+
+    return Vector2d(v1.x / scalar, v1.y / scalar);
+}
+
+//Calculates the gravitational force between 2 planets. Used to figure out planet accelerations / movement
+inline double calculateGravityForce(double mass1, double mass2, double distance)
+{
+        //Force = (G * mass1 * mass2) / (distance^2 + softening^2)
+        //DISTANCE BEING BETWEEN PLANET CENTERS IN METERS
+
+    double force = (G * mass1 * mass2) / (distance * distance + softening2);
+
+    return force;
+}
+
+//Function to get the vector between 2 planets
+inline Vector2d vectorFromPlanets(const Planet& planet1, const Planet& planet2)
+{
+    return planet2.position - planet1.position;
+}
+
+inline Vector2d getVectorFromForce(double mass, double force, Vector2d direction)
+{
+    double magnitude = (force / mass);
+    return direction * magnitude;
+}
+
+//Dot product funct9on
+inline double dot(const Vector2d& a, const Vector2d& b) { return a.x * b.x + a.y * b.y; }
+
+inline double len(const Vector2d& v) { return std::sqrt(dot(v, v)); }
+
+//Function that multiplies 2 vectors together
+template <typename T>
+inline sf::Vector2<T> multiplyVectors(sf::Vector2<T> v1, sf::Vector2<T> v2) {
+
+    return sf::Vector2<T>(v1.x * v2.x, v1.y * v2.y);
+}
+
+//Function that multiplies a vector by a scalar
+inline Vector2d multiplyVectorByDouble(Vector2d v1, double scalar) {
+
+    return Vector2d(v1.x * scalar, v1.y * scalar);
+}
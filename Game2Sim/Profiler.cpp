@@ -0,0 +1,198 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+const char* profilePhaseName(ProfilePhase phase)
+{
+    switch (phase)
+    {
+    case ProfilePhase::Events: return "Events";
+    case ProfilePhase::Gravity: return "Gravity";
+    case ProfilePhase::Integration: return "Integration";
+    case ProfilePhase::Collisions: return "Collisions";
+    case ProfilePhase::Diagnostics: return "Diagnostics";
+    case ProfilePhase::Draw: return "Draw";
+    case ProfilePhase::Display: return "Display";
+    default: return "?";
+    }
+}
+
+static FrameProfiler*& threadProfiler()
+{
+    thread_local FrameProfiler* profiler = nullptr;
+    return profiler;
+}
+
+FrameProfiler& frameProfiler()
+{
+    static FrameProfiler mainProfiler;
+    FrameProfiler* profiler = threadProfiler();
+    return profiler ? *profiler : mainProfiler;
+}
+
+void setThreadProfiler(FrameProfiler* profiler)
+{
+    threadProfiler() = profiler;
+}
+
+void FrameProfiler::endFrame()
+{
+    auto now = std::chrono::steady_clock::now();
+    traceBuffer().record(frameName, frameStart, now);
+    frameStart = now;
+
+    std::lock_guard<std::mutex> lock(historyMutex);
+    std::size_t slot = framesRecorded % historyLength;
+    for (std::size_t phase = 0; phase < phaseCount; ++phase)
+    {
+        history[phase][slot] = static_cast<float>(currentFrame[phase]);
+        currentFrame[phase] = 0.0;
+    }
+    ++framesRecorded;
+}
+
+std::size_t FrameProfiler::sampleCount() const
+{
+    std::lock_guard<std::mutex> lock(historyMutex);
+    return framesRecorded < historyLength ? framesRecorded : historyLength;
+}
+
+PhaseStats FrameProfiler::stats(ProfilePhase phase)
+{
+    PhaseStats result;
+    std::size_t count = sampleCount();
+    std::lock_guard<std::mutex> lock(historyMutex);
+    if (count == 0)
+    {
+        return result;
+    }
+
+    const std::array<float, historyLength>& samples = history[static_cast<std::size_t>(phase)];
+    sortScratch.assign(samples.begin(), samples.begin() + count);
+    std::sort(sortScratch.begin(), sortScratch.end());
+
+    double total = 0.0;
+    for (float sample : sortScratch)
+    {
+        total += sample;
+    }
+    result.mean = total / count;
+
+    //Nearest rank, so p99 of fewer than 100 frames is just the slowest one
+    auto percentile = [&](double fraction)
+    {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(fraction * count));
+        return static_cast<double>(sortScratch[std::min(std::max<std::size_t>(rank, 1), count) - 1]);
+    };
+    result.p95 = percentile(0.95);
+    result.p99 = percentile(0.99);
+    return result;
+}
+
+TraceBuffer::TraceBuffer() : slots(new Slot[capacity])
+{
+}
+
+TraceBuffer& traceBuffer()
+{
+    static TraceBuffer buffer;
+    return buffer;
+}
+
+unsigned traceThreadId()
+{
+    static std::atomic<unsigned> nextThread{ 0 };
+    thread_local unsigned id = nextThread++;
+    return id;
+}
+
+const char*& currentTraceScope()
+{
+    thread_local const char* scope = nullptr;
+    return scope;
+}
+
+void TraceBuffer::record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    std::uint64_t index = nextEvent.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots[index % capacity];
+
+    //Same idea as a seqlock: odd while the fields are changing, so a reader can tell it got a torn copy
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.thread.store(traceThreadId(), std::memory_order_relaxed);
+    slot.start.store(std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count(), std::memory_order_relaxed);
+    slot.duration.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), std::memory_order_relaxed);
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+void TraceBuffer::nameThread(const std::string& name)
+{
+    unsigned thread = traceThreadId();
+    std::lock_guard<std::mutex> lock(threadNamesMutex);
+    if (threadNames.size() <= thread)
+    {
+        threadNames.resize(thread + 1);
+    }
+    threadNames[thread] = name;
+}
+
+bool TraceBuffer::writeJson(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    //Timestamps are microseconds in the format, three decimals keeps the nanoseconds
+    file.setf(std::ios::fixed);
+    file.precision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> lock(threadNamesMutex);
+        for (std::size_t thread = 0; thread < threadNames.size(); ++thread)
+        {
+            if (threadNames[thread].empty())
+            {
+                continue;
+            }
+            //Thread names come from code, not the user, so they don't need escaping
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+                << ",\"args\":{\"name\":\"" << threadNames[thread] << "\"}}";
+            first = false;
+        }
+    }
+
+    //Only the newest `capacity` events are still in the buffer
+    std::uint64_t end = nextEvent.load(std::memory_order_acquire);
+    std::uint64_t begin = end > capacity ? end - capacity : 0;
+    for (std::uint64_t index = begin; index < end; ++index)
+    {
+        const Slot& slot = slots[index % capacity];
+        std::uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        const char* name = slot.name.load(std::memory_order_relaxed);
+        unsigned thread = slot.thread.load(std::memory_order_relaxed);
+        long long start = slot.start.load(std::memory_order_relaxed);
+        long long duration = slot.duration.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        //Still being written, or already overwritten by a newer event
+        if (before != 2 * index + 2 || slot.sequence.load(std::memory_order_relaxed) != before)
+        {
+            continue;
+        }
+
+        file << (first ? "" : ",\n") << "{\"name\":\"" << name << "\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+            << ",\"ts\":" << start / 1000.0 << ",\"dur\":" << duration / 1000.0 << "}";
+        first = false;
+    }
+
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
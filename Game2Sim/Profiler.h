@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Parts of a frame that are timed separately
+enum class ProfilePhase
+{
+    Events,      //Polling window events and handling input
+    Gravity,     //Force pass, whichever solver
+    Integration, //Kicks, drifts and edge bounces
+    Collisions,  //Broadphase and collision response
+    Diagnostics, //Energy and momentum rows
+    Draw,        //Building vertices and draw calls
+    Display,     //window.display(), includes waiting for vsync
+    Count
+};
+
+const char* profilePhaseName(ProfilePhase phase);
+
+//Milliseconds a phase took per frame over the recorded frames
+struct PhaseStats
+{
+    double mean = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+};
+
+//Adds up how long each phase takes in a frame and keeps the totals for the last historyLength frames.
+//Phases are added by the one thread that owns the profiler (phases that run on the pool are timed around the whole
+//parallel pass). endFrame() and stats() lock, so another thread can read the stats, e.g. the overlay showing the simulation thread.
+struct FrameProfiler
+{
+    static constexpr std::size_t phaseCount = static_cast<std::size_t>(ProfilePhase::Count);
+    static constexpr std::size_t historyLength = 240; //About 4 seconds at 60 fps
+
+    std::array<double, phaseCount> currentFrame{}; //Milliseconds so far this frame
+    std::array<std::array<float, historyLength>, phaseCount> history{};
+    std::size_t framesRecorded = 0;
+    std::vector<float> sortScratch; //Kept so stats() doesn't allocate
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now(); //For the frame event in the trace
+    const char* frameName = "Frame"; //Name of the event covering each whole frame in the trace
+    mutable std::mutex historyMutex;
+
+public:
+    void add(ProfilePhase phase, double milliseconds) { currentFrame[static_cast<std::size_t>(phase)] += milliseconds; }
+
+    //Moves this frame's totals into the history and starts a new frame
+    void endFrame();
+
+    PhaseStats stats(ProfilePhase phase);
+    std::size_t sampleCount() const;
+};
+
+//The profiler the scoped timers on this thread report to. The main one unless the thread picked its own
+FrameProfiler& frameProfiler();
+
+//Makes the calling thread's timers report to profiler, nullptr goes back to the main one
+void setThreadProfiler(FrameProfiler* profiler);
+
+//Keeps the last `capacity` timed scopes from every thread so the last few seconds can be written out as
+//Chrome Trace Event JSON, to look at in chrome://tracing or ui.perfetto.dev.
+//Recording never locks: a thread claims a slot with one fetch_add and stamps it with a sequence number once it's
+//written, so writing the file can skip a slot that is being overwritten instead of making anyone wait.
+struct TraceBuffer
+{
+    static constexpr std::size_t capacity = 1 << 16; //Around 10 seconds of a 60 fps frame with a 16 thread pool
+
+    struct Slot
+    {
+        std::atomic<std::uint64_t> sequence{ 0 }; //2 * index + 2 once event index is written, odd while writing
+        std::atomic<const char*> name{ nullptr };  //Must outlive the buffer, phase names are string literals
+        std::atomic<unsigned> thread{ 0 };
+        std::atomic<long long> start{ 0 };         //Nanoseconds since epoch
+        std::atomic<long long> duration{ 0 };
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<std::uint64_t> nextEvent{ 0 };
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    std::mutex threadNamesMutex; //Only taken when a thread is named or the file is written
+    std::vector<std::string> threadNames;
+
+public:
+    TraceBuffer();
+
+    TraceBuffer(const TraceBuffer&) = delete;
+    TraceBuffer& operator=(const TraceBuffer&) = delete;
+
+    //Safe to call from any thread
+    void record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+    //Label shown for the calling thread in the trace viewer
+    void nameThread(const std::string& name);
+
+    //Returns false if the file can't be created
+    bool writeJson(const std::string& path);
+};
+
+//The trace the scoped timers and the thread pool record into
+TraceBuffer& traceBuffer();
+
+//Small number for the calling thread, given out in the order threads first record something
+unsigned traceThreadId();
+
+//Name of the innermost phase being timed on this thread, or nullptr. The thread pool tags its workers' events with
+//the caller's phase, so a parallel force pass shows up as Gravity on every worker
+const char*& currentTraceScope();
+
+//Times from construction to the end of the scope, adds it to the phase and records it in the trace
+struct ScopedPhaseTimer
+{
+    ProfilePhase phase;
+    const char* outerScope;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedPhaseTimer(ProfilePhase phase) : phase(phase), outerScope(currentTraceScope()), start(std::chrono::steady_clock::now())
+    {
+        currentTraceScope() = profilePhaseName(phase);
+    }
+    ~ScopedPhaseTimer()
+    {
+        auto end = std::chrono::steady_clock::now();
+        frameProfiler().add(phase, std::chrono::duration<double, std::milli>(end - start).count());
+        traceBuffer().record(profilePhaseName(phase), start, end);
+        currentTraceScope() = outerScope;
+    }
+};
+
+//GAME2_DISABLE_PROFILER removes every timer and the trace buffer is never made. The Release configurations define it,
+//add GAME2_ENABLE_PROFILER to a Release build to profile it anyway
+#if defined(GAME2_DISABLE_PROFILER) && !defined(GAME2_ENABLE_PROFILER)
+constexpr bool profilerEnabled = false;
+#define GAME2_PROFILE_SCOPE(phase)
+#define GAME2_PROFILE_END_FRAME()
+#else
+constexpr bool profilerEnabled = true;
+#define GAME2_PROFILE_CONCAT_INNER(a, b) a##b
+#define GAME2_PROFILE_CONCAT(a, b) GAME2_PROFILE_CONCAT_INNER(a, b)
+#define GAME2_PROFILE_SCOPE(phase) ScopedPhaseTimer GAME2_PROFILE_CONCAT(phaseTimer, __LINE__)(phase)
+#define GAME2_PROFILE_END_FRAME() frameProfiler().endFrame()
+#endif
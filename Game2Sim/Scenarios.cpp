@@ -0,0 +1,169 @@
+#include "Scenarios.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+namespace
+{
+    const double pi = 3.14159265358979323846;
+
+    //Sizes for the default 19.2 x 10.8 m world
+    const double totalMass = 1.0e13;   //kg, the same as 1000 of the planets the game places
+    const double diskRadius = 4.0;     //m
+    const double plummerRadius = 1.0;  //m, Plummer scale length
+    const double maxPlummerRadius = 5.0 * plummerRadius; //The Plummer tail goes on forever, planets past this are redrawn
+    const double coveredFraction = 0.02; //Share of the disk area the planets cover between them
+
+    //std distributions give different numbers on different standard libraries, the raw mt19937 output doesn't
+    double uniform(std::mt19937& rng)
+    {
+        return (rng() + 0.5) / 4294967296.0;
+    }
+
+    //Random sampling leaves a group off center and drifting a little. Moves planets[first..] so their
+    //center of mass sits at center and moves at drift (all planets in a group have the same mass)
+    void recenter(std::vector<Planet>& planets, std::size_t first, Vector2d center, Vector2d drift)
+    {
+        Vector2d averagePosition(0.0, 0.0);
+        Vector2d averageVelocity(0.0, 0.0);
+        for (std::size_t i = first; i < planets.size(); ++i)
+        {
+            averagePosition += planets[i].position;
+            averageVelocity += planets[i].velocity;
+        }
+        const double count = static_cast<double>(planets.size() - first);
+        averagePosition /= count;
+        averageVelocity /= count;
+        for (std::size_t i = first; i < planets.size(); ++i)
+        {
+            planets[i].position += center - averagePosition;
+            planets[i].velocity += drift - averageVelocity;
+        }
+    }
+
+    double planetRadius(std::size_t count, double spread)
+    {
+        return spread * std::sqrt(coveredFraction / static_cast<double>(std::max<std::size_t>(count, 1)));
+    }
+
+    void addDisk(std::vector<Planet>& planets, std::size_t count, Vector2d center, std::mt19937& rng)
+    {
+        const double mass = totalMass / static_cast<double>(count);
+        const double radius = planetRadius(count, diskRadius);
+        const std::size_t first = planets.size();
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            //sqrt spreads planets evenly over the area instead of bunching them in the middle
+            double r = diskRadius * std::sqrt(uniform(rng));
+            double angle = 2.0 * pi * uniform(rng);
+            Vector2d direction(std::cos(angle), std::sin(angle));
+
+            //Circular speed from the mass inside r, which is totalMass * (r/R)^2 for a uniform disk
+            double enclosedMass = totalMass * (r * r) / (diskRadius * diskRadius);
+            double speed = std::sqrt(G * enclosedMass / std::max(r, radius));
+
+            Planet planet{ direction * r, radius, mass, Vector2d(-direction.y, direction.x) * speed };
+            planets.push_back(planet);
+        }
+        recenter(planets, first, center, { 0.0, 0.0 });
+    }
+
+    //Aarseth, Henon & Wielen (1974): positions from the cumulative mass, speeds by rejection sampling the distribution function.
+    //Done in 3D and projected onto the screen plane
+    void addPlummer(std::vector<Planet>& planets, std::size_t count, double clusterMass, Vector2d center, Vector2d drift,
+        std::mt19937& rng)
+    {
+        const double mass = clusterMass / static_cast<double>(count);
+        const double radius = planetRadius(count, plummerRadius);
+        const double velocityScale = std::sqrt(G * clusterMass / plummerRadius);
+        const std::size_t first = planets.size();
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            double r;
+            do
+            {
+                r = 1.0 / std::sqrt(std::pow(uniform(rng), -2.0 / 3.0) - 1.0);
+            } while (r * plummerRadius > maxPlummerRadius);
+
+            //Random direction in 3D, only x and y are kept
+            double z = 2.0 * uniform(rng) - 1.0;
+            double angle = 2.0 * pi * uniform(rng);
+            double ring = std::sqrt(1.0 - z * z);
+            Vector2d position(r * ring * std::cos(angle), r * ring * std::sin(angle));
+
+            double q, g;
+            do
+            {
+                q = uniform(rng);
+                g = 0.1 * uniform(rng);
+            } while (g > q * q * std::pow(1.0 - q * q, 3.5));
+            double speed = q * std::sqrt(2.0) * std::pow(1.0 + r * r, -0.25);
+
+            z = 2.0 * uniform(rng) - 1.0;
+            angle = 2.0 * pi * uniform(rng);
+            ring = std::sqrt(1.0 - z * z);
+            Vector2d velocity(speed * ring * std::cos(angle), speed * ring * std::sin(angle));
+
+            Planet planet{ position * plummerRadius, radius, mass, velocity * velocityScale };
+            planets.push_back(planet);
+        }
+
+        recenter(planets, first, center, drift);
+    }
+}
+
+const char* scenarioName(Scenario scenario)
+{
+    switch (scenario)
+    {
+    case Scenario::PlummerSphere: return "plummer";
+    case Scenario::CollidingClusters: return "clusters";
+    default: return "disk";
+    }
+}
+
+bool parseScenario(const std::string& name, Scenario& scenario)
+{
+    for (Scenario candidate : { Scenario::UniformDisk, Scenario::PlummerSphere, Scenario::CollidingClusters })
+    {
+        if (name == scenarioName(candidate))
+        {
+            scenario = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<Planet> generateScenario(Scenario scenario, std::size_t count, unsigned seed, Vector2d center)
+{
+    std::mt19937 rng(seed);
+    std::vector<Planet> planets;
+    planets.reserve(count);
+
+    switch (scenario)
+    {
+    case Scenario::UniformDisk:
+        addDisk(planets, count, center, rng);
+        break;
+    case Scenario::PlummerSphere:
+        addPlummer(planets, count, totalMass, center, { 0.0, 0.0 }, rng);
+        break;
+    case Scenario::CollidingClusters:
+    {
+        //3 scale lengths either side of the middle, closing at half the escape speed from a cluster's center
+        double offset = 3.0 * plummerRadius;
+        double closingSpeed = 0.5 * std::sqrt(G * totalMass / plummerRadius);
+        std::size_t firstHalf = count / 2;
+        addPlummer(planets, firstHalf, totalMass / 2.0, center - Vector2d(offset, 0.0), { closingSpeed / 2.0, 0.0 }, rng);
+        addPlummer(planets, count - firstHalf, totalMass / 2.0, center + Vector2d(offset, 0.0), { -closingSpeed / 2.0, 0.0 }, rng);
+        break;
+    }
+    }
+
+    return planets;
+}
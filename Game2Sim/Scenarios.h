@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Physics.h"
+#include <string>
+#include <vector>
+
+//Starting setups that give the same planets for the same seed on any machine, for benchmarks and comparing runs
+enum class Scenario
+{
+    UniformDisk,       //Planets spread evenly over a disk, each on a circular orbit around the middle
+    PlummerSphere,     //A star cluster (Plummer model) seen from above
+    CollidingClusters  //Two Plummer spheres heading into each other
+};
+
+const char* scenarioName(Scenario scenario);
+//Accepts the names scenarioName gives, returns false for anything else
+bool parseScenario(const std::string& name, Scenario& scenario);
+
+//count planets around center. Total mass and size don't change with count, so every count behaves roughly the same,
+//and planet radius shrinks with count so planets cover about the same share of the area.
+std::vector<Planet> generateScenario(Scenario scenario, std::size_t count, unsigned seed, Vector2d center);
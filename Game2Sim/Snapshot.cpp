@@ -0,0 +1,113 @@
+#include "Snapshot.h"
+
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+bool saveSnapshot(const std::string& path, const std::vector<Planet>& planets, double simulationTime, long long stepCount)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = snapshotVersion;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.planetCount = planets.size();
+    header.recordSize = sizeof(SnapshotRecord);
+    header.simulationTime = simulationTime;
+    header.stepCount = stepCount;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    //Written a block at a time, one write per planet is several times slower for big saves
+    constexpr std::size_t blockSize = 4096;
+    std::vector<SnapshotRecord> block;
+    block.reserve(std::min(blockSize, planets.size()));
+    for (std::size_t first = 0; first < planets.size(); first += blockSize)
+    {
+        block.clear();
+        std::size_t last = std::min(first + blockSize, planets.size());
+        for (std::size_t i = first; i < last; ++i)
+        {
+            const Planet& planet = planets[i];
+            block.push_back({ planet.position.x, planet.position.y, planet.velocity.x, planet.velocity.y,
+                planet.mass, planet.radius, planet.color.toInteger(), 0 });
+        }
+        file.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(SnapshotRecord)));
+    }
+
+    return static_cast<bool>(file.flush());
+}
+
+bool loadSnapshot(const std::string& path, SnapshotContents& snapshot, std::string& error)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        error = "can't open the file";
+        return false;
+    }
+
+    SnapshotHeader header = {};
+    if (file.size() < sizeof(SnapshotHeader) || std::memcmp(file.data(), snapshotMagic, sizeof(snapshotMagic)) != 0)
+    {
+        error = "not a snapshot file";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.version == 0)
+    {
+        error = "not a snapshot file";
+        return false;
+    }
+    if (header.version > snapshotVersion)
+    {
+        error = "snapshot version " + std::to_string(header.version) + " is newer than this build reads (" + std::to_string(snapshotVersion) + ")";
+        return false;
+    }
+    if (header.headerSize < sizeof(SnapshotHeader) || file.size() < header.headerSize)
+    {
+        error = "header is cut short";
+        return false;
+    }
+    if (header.recordSize < sizeof(SnapshotRecord))
+    {
+        error = "planet records are smaller than version 1's";
+        return false;
+    }
+    const std::uint64_t available = (file.size() - header.headerSize) / header.recordSize;
+    if (available < header.planetCount)
+    {
+        error = "file is cut short, it has " + std::to_string(available) + " of " + std::to_string(header.planetCount) + " planets";
+        return false;
+    }
+
+    snapshot.simulationTime = header.simulationTime;
+    snapshot.stepCount = header.stepCount;
+    snapshot.planets.clear();
+    snapshot.planets.reserve(static_cast<std::size_t>(header.planetCount));
+
+    const unsigned char* records = file.data() + header.headerSize;
+    for (std::uint64_t i = 0; i < header.planetCount; ++i)
+    {
+        //memcpy rather than a cast, the mapping only promises byte alignment once recordSize isn't a multiple of 8
+        SnapshotRecord record;
+        std::memcpy(&record, records + i * header.recordSize, sizeof(record));
+        snapshot.planets.push_back(Planet{ { record.positionX, record.positionY }, record.radius, record.mass,
+            { record.velocityX, record.velocityY }, sf::Color(record.color) });
+    }
+    return true;
+}
+
+bool isSnapshotFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(snapshotMagic)] = {};
+    file.read(magic, sizeof(magic));
+    return file && std::memcmp(magic, snapshotMagic, sizeof(magic)) == 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Physics.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Binary save of every planet, so a run can be stopped and carried on later or shared.
+//Layout (little endian, as written by x86): a SnapshotHeader, then planetCount SnapshotRecords one after another.
+//Fields are only ever added to the end of the header or a record, and headerSize / recordSize say how big the writer's
+//were, so a reader steps over anything newer than it knows about. version goes up when a field changes meaning.
+constexpr char snapshotMagic[8] = { 'G', 'A', 'M', 'E', '2', 'S', 'N', 'P' };
+constexpr std::uint32_t snapshotVersion = 1;
+
+struct SnapshotHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t headerSize;   //sizeof(SnapshotHeader) when it was written
+    std::uint64_t planetCount;
+    std::uint32_t recordSize;   //sizeof(SnapshotRecord) when it was written
+    std::uint32_t reserved;
+    double simulationTime;      //Seconds
+    std::int64_t stepCount;
+};
+
+struct SnapshotRecord
+{
+    double positionX, positionY;   //Meters
+    double velocityX, velocityY;   //Meters per second
+    double mass;                   //Kilograms
+    double radius;                 //Meters
+    std::uint32_t color;           //sf::Color::toInteger, 0xRRGGBBAA
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 48, "Snapshot header layout is part of the file format");
+static_assert(sizeof(SnapshotRecord) == 56, "Snapshot record layout is part of the file format");
+
+//Everything needed to carry on a run
+struct SnapshotContents
+{
+    std::vector<Planet> planets;
+    double simulationTime = 0.0;
+    long long stepCount = 0;
+};
+
+//Returns false if the file can't be written
+bool saveSnapshot(const std::string& path, const std::vector<Planet>& planets, double simulationTime, long long stepCount);
+
+//Reads the file through a memory mapping. Returns false with the reason in error if it can't be read,
+//isn't a snapshot, was written by a newer version or is cut short
+bool loadSnapshot(const std::string& path, SnapshotContents& snapshot, std::string& error);
+
+//True if the file starts like a snapshot, so callers can fall back to the text planet format when it doesn't
+bool isSnapshotFile(const std::string& path);
@@ -0,0 +1,126 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <string>
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    for (unsigned worker = 1; worker < std::max(threadCount, 1u); ++worker)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this, worker);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::hardwareThreads()
+{
+    //hardware_concurrency can return 0 when it can't tell
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t chunkSize, const RangeTask& rangeTask)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+
+    //Not worth waking anyone for a single chunk
+    if (workers.empty() || count <= chunkSize)
+    {
+        rangeTask(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &rangeTask;
+        taskName = currentTraceScope() ? currentTraceScope() : "Parallel pass";
+        taskCount = count;
+        taskChunkSize = chunkSize;
+        nextIndex = 0;
+        pendingWorkers = static_cast<unsigned>(workers.size());
+        ++generation;
+    }
+    wake.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return pendingWorkers == 0; });
+    task = nullptr;
+}
+
+void ThreadPool::workerLoop(unsigned worker)
+{
+    std::uint64_t seenGeneration = 0;
+    if (profilerEnabled)
+    {
+        traceBuffer().nameThread("Worker " + std::to_string(worker));
+    }
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping)
+            {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runChunks(worker);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pendingWorkers == 0)
+        {
+            finished.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runChunks(unsigned worker)
+{
+    std::chrono::steady_clock::time_point start;
+    if (profilerEnabled)
+    {
+        start = std::chrono::steady_clock::now();
+    }
+    bool ranChunk = false;
+
+    //Threads grab the next chunk as they finish, so uneven chunks (e.g. Barnes-Hut walks) still balance out
+    while (true)
+    {
+        std::size_t begin = nextIndex.fetch_add(taskChunkSize);
+        if (begin >= taskCount)
+        {
+            break;
+        }
+        (*task)(begin, std::min(begin + taskChunkSize, taskCount), worker);
+        ranChunk = true;
+    }
+
+    //One event per thread per pass, from waking up to running out of chunks
+    if (profilerEnabled && ranChunk)
+    {
+        traceBuffer().record(taskName, start, std::chrono::steady_clock::now());
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//Non-owning handle to a callable taking (begin, end, worker). Unlike std::function it never copies the callable
+//onto the heap, so passing a lambda to parallelFor every step doesn't allocate.
+//Only valid while the callable it was made from is alive, which parallelFor's blocking guarantees.
+struct RangeTask
+{
+    const void* callable;
+    void (*invoke)(const void*, std::size_t, std::size_t, unsigned);
+
+public:
+    template <typename Function, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Function>, RangeTask>>>
+    RangeTask(const Function& function)
+        : callable(&function),
+        invoke([](const void* target, std::size_t begin, std::size_t end, unsigned worker)
+        {
+            (*static_cast<const Function*>(target))(begin, end, worker);
+        })
+    {
+    }
+
+    void operator()(std::size_t begin, std::size_t end, unsigned worker) const { invoke(callable, begin, end, worker); }
+};
+
+//Fixed set of worker threads that are kept alive between frames, so splitting a pass across cores
+//doesn't pay for creating threads every time. The calling thread does work too (as worker 0).
+struct ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    //task(begin, end, worker) handles the items [begin, end), worker is in [0, threadCount()).
+    //Runs task over [0, count) in chunks of chunkSize spread over all threads, returns once every chunk is done
+    void parallelFor(std::size_t count, std::size_t chunkSize, const RangeTask& task);
+
+    //Default thread count: one per hardware thread
+    static unsigned hardwareThreads();
+
+private:
+    void workerLoop(unsigned worker);
+    void runChunks(unsigned worker);
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::uint64_t generation = 0; //Bumped for every parallelFor so sleeping workers know there is new work
+    unsigned pendingWorkers = 0;
+    bool stopping = false;
+
+    const RangeTask* task = nullptr;
+    const char* taskName = nullptr; //Phase the caller was in, for the trace
+    std::size_t taskCount = 0;
+    std::size_t taskChunkSize = 1;
+    std::atomic<std::size_t> nextIndex{ 0 };
+};
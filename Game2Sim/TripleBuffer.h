@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+//Hands the newest value from one writer thread to one reader thread without either of them ever waiting.
+//There are three slots: the writer fills its back slot and publish() swaps it with the middle one, the reader's
+//acquire() swaps the middle slot into its front slot if anything new was published since. The writer and reader
+//never share a slot, so the reader's value stays untouched until it acquires again.
+template <typename T>
+struct TripleBuffer
+{
+    static constexpr std::uint8_t indexMask = 3;
+    static constexpr std::uint8_t freshBit = 4; //Set in middle when it holds a value the reader hasn't taken yet
+
+    std::array<T, 3> slots;
+    std::atomic<std::uint8_t> middle{ 1 };
+    std::uint8_t back = 0;  //Writer only
+    std::uint8_t front = 2; //Reader only
+
+public:
+    //Writer: the slot to fill next. Holds an old value, overwrite all of it
+    T& writeSlot() { return slots[back]; }
+
+    //Writer: makes writeSlot() the newest value and hands back another slot to fill
+    void publish()
+    {
+        back = middle.exchange(static_cast<std::uint8_t>(back | freshBit), std::memory_order_acq_rel) & indexMask;
+    }
+
+    //Reader: moves to the newest value if there is one, returns false if nothing was published since last time
+    bool acquire()
+    {
+        if ((middle.load(std::memory_order_relaxed) & freshBit) == 0)
+        {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    //Reader: the value from the last acquire()
+    const T& readSlot() const { return slots[front]; }
+};
@@ -0,0 +1,544 @@
+#include "World.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+const char* gravitySolverName(GravitySolver solver)
+{
+    switch (solver)
+    {
+    case GravitySolver::BarnesHut: return "barnes-hut";
+    case GravitySolver::ParticleMesh: return "pm";
+    case GravitySolver::FastMultipole: return "fmm";
+    default: return "direct";
+    }
+}
+
+const char* integratorName(Integrator integrator)
+{
+    switch (integrator)
+    {
+    case Integrator::Leapfrog: return "leapfrog";
+    case Integrator::Yoshida: return "yoshida";
+    case Integrator::Block: return "block";
+    default: return "euler";
+    }
+}
+
+//Grows to at least double the old capacity, so a run of small increases only reallocates a few times
+template <typename Vector>
+static void reserveGrowing(Vector& vector, std::size_t count)
+{
+    if (vector.capacity() < count)
+    {
+        vector.reserve(std::max(count, vector.capacity() * 2));
+    }
+}
+
+void WorldScratch::reserve(std::size_t planetCount)
+{
+    reserveGrowing(planetAccelerations, planetCount);
+    reserveGrowing(diagnosticsRows, planetCount);
+
+    std::size_t padded = (planetCount + BodyStore::lanePadding - 1) / BodyStore::lanePadding * BodyStore::lanePadding;
+    for (AlignedVector<double>* field : { &bodyStore.x, &bodyStore.y, &bodyStore.vx, &bodyStore.vy, &bodyStore.mass, &bodyStore.radius })
+    {
+        reserveGrowing(*field, padded);
+    }
+
+    reserveGrowing(barnesHutTree.nextInLeaf, planetCount);
+    reserveGrowing(collisionGrid.planetBucket, planetCount);
+    reserveGrowing(collisionGrid.bucketEntries, planetCount);
+    reserveGrowing(mergeScratch.group, planetCount);
+    reserveGrowing(mergeScratch.keptFrom, planetCount);
+    reserveGrowing(contactIslands.group, planetCount);
+    reserveGrowing(contactIslands.sleepingIsland, planetCount);
+    reserveGrowing(contactIslands.islandState, planetCount);
+    reserveGrowing(contactIslands.islandMass, planetCount);
+    reserveGrowing(contactIslands.islandEnergy, planetCount);
+    reserveGrowing(contactIslands.islandQuiet, planetCount);
+    reserveGrowing(contactIslands.islandMomentum, planetCount);
+    reserveGrowing(contactIslands.sleepingMass, planetCount);
+    reserveGrowing(contactIslands.sleepingPull, planetCount);
+    reserveGrowing(contactIslands.sleepingStrain, planetCount);
+    reserveGrowing(contactIslands.sleepingSupport, planetCount);
+    reserveGrowing(contactIslands.sleepingDrift, planetCount);
+    reserveGrowing(contactIslands.supportKnown, planetCount);
+    reserveGrowing(timestepLevels, planetCount);
+    reserveGrowing(previousAccelerations, planetCount);
+    reserveGrowing(allAccelerations, planetCount);
+    reserveGrowing(activePlanets, planetCount);
+    //Tree nodes and candidate pairs depend on where the planets are rather than how many there are,
+    //they keep whatever they grew to on the busiest step so far
+}
+
+World::World(const WorldSettings& settings) : settings(settings), threadPool(settings.threads)
+{
+}
+
+void World::step(double deltaTime)
+{
+    switch (settings.integrator)
+    {
+    case Integrator::Leapfrog: stepLeapfrog(deltaTime); break;
+    case Integrator::Yoshida: stepYoshida(deltaTime); break;
+    case Integrator::Block: stepBlock(deltaTime); break;
+    default: stepEuler(deltaTime); break;
+    }
+
+    {
+        GAME2_PROFILE_SCOPE(ProfilePhase::Collisions);
+        if (settings.collisionMode == CollisionMode::Merge)
+        {
+            mergeCollisions();
+        }
+        else if (settings.sleeping)
+        {
+            scratch.contactIslands.resolve(planets, scratch.collisionGrid, settings.sleep);
+        }
+        else
+        {
+            resolvePlanetCollisions(planets, scratch.collisionGrid);
+        }
+    }
+    publishRenderPlanets();
+
+    ++stepCount;
+    simulationTime += deltaTime;
+}
+
+EnergyMomentum World::measureEnergyMomentum()
+{
+    return ::measureEnergyMomentum(planets, settings.softening * settings.softening, threadPool, scratch.diagnosticsRows);
+}
+
+void World::setIntegrator(Integrator integrator)
+{
+    settings.integrator = integrator;
+    accelerationsValid = false;
+}
+
+std::size_t World::addPlanet(const Planet& planet)
+{
+    planets.push_back(planet);
+    scratch.reserve(planets.size());
+    sf::Vector2f position(planet.position);
+    renderPlanets.push_back({ position, position, static_cast<float>(planet.radius), planet.color });
+    accelerationsValid = false;
+    return planets.size() - 1;
+}
+
+void World::removePlanet(std::size_t index)
+{
+    if (index < planets.size())
+    {
+        //Sleeping islands are kept by index
+        ContactIslands::wakeAll(planets);
+        planets.erase(planets.begin() + index);
+        renderPlanets.erase(renderPlanets.begin() + index);
+        accelerationsValid = false;
+    }
+}
+
+void World::clear()
+{
+    planets.clear();
+    renderPlanets.clear();
+    accelerationsValid = false;
+}
+
+void World::loadState(std::vector<Planet> newPlanets, double newSimulationTime, long long newStepCount)
+{
+    planets = std::move(newPlanets);
+    scratch.reserve(planets.size());
+    renderPlanets.clear();
+    renderPlanets.reserve(planets.size());
+    for (const Planet& planet : planets)
+    {
+        sf::Vector2f position(planet.position);
+        renderPlanets.push_back({ position, position, static_cast<float>(planet.radius), planet.color });
+    }
+    simulationTime = newSimulationTime;
+    stepCount = newStepCount;
+    accelerationsValid = false;
+}
+
+//Works out every planet's acceleration with the solver picked at startup.
+//Each planet's acceleration is summed by one thread in a fixed order, so the result is the same for any thread count.
+void World::computePlanetAccelerations()
+{
+    GAME2_PROFILE_SCOPE(ProfilePhase::Gravity);
+    computeAccelerationsInto(scratch.planetAccelerations);
+}
+
+void World::computeAccelerationsInto(std::vector<Vector2d>& planetAccelerations)
+{
+    planetAccelerations.resize(planets.size());
+    forceEvaluations += static_cast<long long>(planets.size());
+    const double softening2 = settings.softening * settings.softening;
+
+    if (settings.solver == GravitySolver::BarnesHut)
+    {
+        computeBarnesHutAccelerations(planets, planetAccelerations, scratch.barnesHutTree, settings.theta, softening2, threadPool);
+        return;
+    }
+    if (settings.solver == GravitySolver::ParticleMesh)
+    {
+        computeParticleMeshAccelerations(planets, planetAccelerations, scratch.particleMesh, settings.meshSize, softening2, threadPool);
+        return;
+    }
+    if (settings.solver == GravitySolver::FastMultipole)
+    {
+        computeFastMultipoleAccelerations(planets, planetAccelerations, scratch.fastMultipoleTree, settings.multipoleOrder, softening2, threadPool);
+        return;
+    }
+
+    scratch.bodyStore.loadFromPlanets(planets);
+    threadPool.parallelFor(planets.size(), 64, [&](std::size_t begin, std::size_t end, unsigned)
+    {
+        computeDirectSumAccelerations(scratch.bodyStore, planetAccelerations, settings.kernel, softening2, begin, end);
+    });
+}
+
+//Direct sum and Barnes-Hut can work out just the active planets. The grid and multipole solvers do every planet
+//in one go anyway, so they do a full pass on the side and only the active planets are copied out of it
+void World::computeActiveAccelerations()
+{
+    GAME2_PROFILE_SCOPE(ProfilePhase::Gravity);
+    const std::vector<std::uint32_t>& active = scratch.activePlanets;
+    std::vector<Vector2d>& planetAccelerations = scratch.planetAccelerations;
+    const double softening2 = settings.softening * settings.softening;
+
+    if (settings.solver == GravitySolver::DirectSum)
+    {
+        forceEvaluations += static_cast<long long>(active.size());
+        scratch.bodyStore.loadFromPlanets(planets);
+        threadPool.parallelFor(active.size(), 8, [&](std::size_t begin, std::size_t end, unsigned)
+        {
+            for (std::size_t k = begin; k < end; ++k)
+            {
+                computeDirectSumAccelerations(scratch.bodyStore, planetAccelerations, settings.kernel, softening2, active[k], active[k] + 1);
+            }
+        });
+        return;
+    }
+    if (settings.solver == GravitySolver::BarnesHut)
+    {
+        forceEvaluations += static_cast<long long>(active.size());
+        scratch.barnesHutTree.build(planets);
+        threadPool.parallelFor(active.size(), 64, [&](std::size_t begin, std::size_t end, unsigned)
+        {
+            for (std::size_t k = begin; k < end; ++k)
+            {
+                planetAccelerations[active[k]] = scratch.barnesHutTree.accelerationOn(active[k], planets, settings.theta, softening2);
+            }
+        });
+        return;
+    }
+
+    computeAccelerationsInto(scratch.allAccelerations);
+    for (std::uint32_t i : active)
+    {
+        planetAccelerations[i] = scratch.allAccelerations[i];
+    }
+}
+
+//----------------------------------------EDGE OF WINDOW COLLISION LOOP------------------------------------
+void World::bounceOffEdges()
+{
+    GAME2_PROFILE_SCOPE(ProfilePhase::Integration);
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        //A sleeping pile drifting into the edge wakes where it hits. This planet bounces now and wakes the rest of
+        //its island next step by touching it
+        if (planets[i].asleep)
+        {
+            const Planet& planet = planets[i];
+            if (planet.position.x - planet.radius >= 0 && planet.position.x + planet.radius <= bounds.x
+                && planet.position.y - planet.radius >= 0 && planet.position.y + planet.radius <= bounds.y)
+            {
+                continue;
+            }
+            planets[i].asleep = false;
+            planets[i].quietSteps = 0;
+        }
+
+        if ((bounds.x < (planets[i].position.x + planets[i].radius)))
+        {
+            planets[i].position.x = bounds.x - planets[i].radius;
+            planets[i].velocity.x = -planets[i].velocity.x;
+        }
+        if (((planets[i].position.x - planets[i].radius) < 0))
+        {
+            planets[i].position.x = planets[i].radius;
+            planets[i].velocity.x = -planets[i].velocity.x;
+        }
+
+        if ((bounds.y < (planets[i].position.y + planets[i].radius)))
+        {
+            planets[i].position.y = bounds.y - planets[i].radius;
+            planets[i].velocity.y = -planets[i].velocity.y;
+        }
+
+        if (((planets[i].position.y - planets[i].radius) < 0))
+        {
+            planets[i].position.y = planets[i].radius;
+            planets[i].velocity.y = -planets[i].velocity.y;
+        }
+    }
+}
+
+void World::kick(double deltaTime)
+{
+    GAME2_PROFILE_SCOPE(ProfilePhase::Integration);
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        //Sleeping planets are kicked a whole island at a time, so the pile stays in one piece
+        if (!planets[i].asleep)
+        {
+            planets[i].velocity += scratch.planetAccelerations[i] * deltaTime;
+        }
+    }
+    if (settings.sleeping)
+    {
+        scratch.contactIslands.kickSleeping(planets, scratch.planetAccelerations, deltaTime, settings.sleep);
+    }
+}
+
+void World::drift(double deltaTime)
+{
+    GAME2_PROFILE_SCOPE(ProfilePhase::Integration);
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        planets[i].position += planets[i].velocity * deltaTime;
+    }
+}
+
+void World::mergeCollisions()
+{
+    if (mergeTouchingPlanets(planets, scratch.collisionGrid, scratch.mergeScratch) == 0)
+    {
+        return;
+    }
+
+    //Same compaction as the planets, so each render copy keeps its previous position for interpolation
+    const std::vector<std::uint32_t>& keptFrom = scratch.mergeScratch.keptFrom;
+    for (std::size_t i = 0; i < keptFrom.size(); ++i)
+    {
+        renderPlanets[i] = renderPlanets[keptFrom[i]];
+    }
+    renderPlanets.resize(planets.size());
+
+    //Masses and positions changed, the old forces don't match any more
+    accelerationsValid = false;
+}
+
+//Only place the simulation is turned into floats, the last published position becomes the previous one
+void World::publishRenderPlanets()
+{
+    GAME2_PROFILE_SCOPE(ProfilePhase::Integration);
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        RenderPlanet& render = renderPlanets[i];
+        render.previousPosition = render.position;
+        render.position = sf::Vector2f(planets[i].position);
+        render.radius = static_cast<float>(planets[i].radius);
+        render.color = planets[i].color;
+    }
+}
+
+//The original integrator: forces at the start of the step, then velocity, then position
+void World::stepEuler(double deltaTime)
+{
+    computePlanetAccelerations();
+    bounceOffEdges();
+    kick(deltaTime);
+    drift(deltaTime);
+
+    //Positions moved after the force pass, so these are stale for leapfrog
+    accelerationsValid = false;
+}
+
+//Kick-drift-kick. The closing kick's forces are the next step's opening kick, so it's one force pass per step.
+//Collisions nudging positions afterwards are small enough to ignore here.
+void World::stepLeapfrog(double deltaTime)
+{
+    bounceOffEdges();
+    if (!accelerationsValid)
+    {
+        computePlanetAccelerations();
+    }
+
+    kick(deltaTime / 2.0);
+    drift(deltaTime);
+    computePlanetAccelerations();
+    kick(deltaTime / 2.0);
+
+    accelerationsValid = true;
+}
+
+//4th order Yoshida: three leapfrog-like substeps with weights that cancel the lower order error terms
+void World::stepYoshida(double deltaTime)
+{
+    const double cubeRootOf2 = std::cbrt(2.0);
+    const double w1 = 1.0 / (2.0 - cubeRootOf2);
+    const double w0 = -cubeRootOf2 / (2.0 - cubeRootOf2);
+
+    const double driftWeights[4] = { w1 / 2.0, (w0 + w1) / 2.0, (w0 + w1) / 2.0, w1 / 2.0 };
+    const double kickWeights[3] = { w1, w0, w1 };
+
+    bounceOffEdges();
+    for (int substep = 0; substep < 3; ++substep)
+    {
+        drift(driftWeights[substep] * deltaTime);
+        computePlanetAccelerations();
+        kick(kickWeights[substep] * deltaTime);
+    }
+    drift(driftWeights[3] * deltaTime);
+
+    accelerationsValid = false;
+}
+
+//Level whose step deltaTime / 2^level is no longer than accuracy * |a| / |jerk| (Aarseth's simplest criterion).
+//A planet whose acceleration isn't changing gets the whole step
+static int blockTimestepLevel(Vector2d acceleration, Vector2d jerk, double deltaTime, double accuracy, int maxLevel)
+{
+    double jerkSize = std::sqrt(dot(jerk, jerk));
+    if (jerkSize == 0.0)
+    {
+        return 0;
+    }
+    double wanted = accuracy * std::sqrt(dot(acceleration, acceleration)) / jerkSize;
+    if (wanted >= deltaTime)
+    {
+        return 0;
+    }
+    if (!(wanted > deltaTime / (1 << maxLevel)))
+    {
+        return maxLevel;
+    }
+    return static_cast<int>(std::ceil(std::log2(deltaTime / wanted)));
+}
+
+//Needs a jerk for every planet before the first block step. Takes one extra force pass a tiny drift ahead and
+//differences it, then puts the positions back. Only happens when the planets change, not every step
+void World::startBlockTimesteps(double deltaTime)
+{
+    const int maxLevel = std::clamp(settings.maxTimestepLevel, 0, 30);
+    const double probe = deltaTime / (1 << maxLevel);
+
+    computePlanetAccelerations();
+    scratch.previousAccelerations.assign(scratch.planetAccelerations.begin(), scratch.planetAccelerations.end());
+    drift(probe);
+    computePlanetAccelerations();
+    drift(-probe);
+
+    scratch.timestepLevels.resize(planets.size());
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        Vector2d jerk = (scratch.planetAccelerations[i] - scratch.previousAccelerations[i]) / probe;
+        scratch.timestepLevels[i] = static_cast<std::uint8_t>(blockTimestepLevel(scratch.previousAccelerations[i], jerk, deltaTime,
+            settings.timestepAccuracy, maxLevel));
+    }
+    std::swap(scratch.planetAccelerations, scratch.previousAccelerations);
+    accelerationsValid = true;
+}
+
+//Kick-drift-kick leapfrog with block timesteps: planet i steps by deltaTime / 2^level[i]. The whole step is cut into
+//ticks of the smallest step, every planet drifts each substep (cheap) but only the planets at the end of their own
+//step get new forces and kicks. Every step starts on a multiple of its own length, so all planets line up again at
+//the end and collisions, diagnostics and drawing see them all at the same time.
+void World::stepBlock(double deltaTime)
+{
+    const int maxLevel = std::clamp(settings.maxTimestepLevel, 0, 30);
+    const std::uint32_t ticksPerStep = 1u << maxLevel;
+    const double tick = deltaTime / ticksPerStep;
+    std::vector<std::uint8_t>& levels = scratch.timestepLevels;
+    std::vector<std::uint32_t>& active = scratch.activePlanets;
+    std::vector<Vector2d>& planetAccelerations = scratch.planetAccelerations;
+
+    bounceOffEdges();
+    if (!accelerationsValid || levels.size() != planets.size())
+    {
+        startBlockTimesteps(deltaTime);
+    }
+
+    auto kickPlanet = [&](std::size_t i, double kickTime)
+    {
+        if (!planets[i].asleep)
+        {
+            planets[i].velocity += planetAccelerations[i] * kickTime;
+        }
+    };
+
+    //Every planet starts a step together. Sleeping islands move slowly and rigidly, they take the whole step as one
+    //kick-drift-kick; every planet has fresh forces at both ends of the step
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        kickPlanet(i, (ticksPerStep >> levels[i]) * tick / 2.0);
+    }
+    if (settings.sleeping)
+    {
+        scratch.contactIslands.kickSleeping(planets, planetAccelerations, deltaTime / 2.0, settings.sleep);
+    }
+
+    std::uint32_t now = 0;
+    while (now < ticksPerStep)
+    {
+        //The planets on the finest level are the next to finish
+        int finest = 0;
+        for (std::uint8_t level : levels)
+        {
+            finest = std::max(finest, static_cast<int>(level));
+        }
+        std::uint32_t substep = ticksPerStep >> finest;
+        drift(substep * tick);
+        now += substep;
+
+        active.clear();
+        for (std::size_t i = 0; i < planets.size(); ++i)
+        {
+            if (now % (ticksPerStep >> levels[i]) == 0)
+            {
+                active.push_back(static_cast<std::uint32_t>(i));
+                scratch.previousAccelerations[i] = planetAccelerations[i];
+            }
+        }
+        computeActiveAccelerations();
+
+        for (std::uint32_t i : active)
+        {
+            const double stepTime = (ticksPerStep >> levels[i]) * tick;
+            kickPlanet(i, stepTime / 2.0);
+
+            //Finer is always allowed. Coarser goes one level at a time, and only when now is on the coarser level's grid
+            Vector2d jerk = (planetAccelerations[i] - scratch.previousAccelerations[i]) / stepTime;
+            int wanted = blockTimestepLevel(planetAccelerations[i], jerk, deltaTime, settings.timestepAccuracy, maxLevel);
+            int level = levels[i];
+            if (wanted > level)
+            {
+                level = wanted;
+            }
+            else if (wanted < level && now % (ticksPerStep >> (level - 1)) == 0)
+            {
+                --level;
+            }
+            levels[i] = static_cast<std::uint8_t>(level);
+
+            //The next step opens here, unless this was the end of the whole step (the next call opens it)
+            if (now < ticksPerStep)
+            {
+                kickPlanet(i, (ticksPerStep >> level) * tick / 2.0);
+            }
+        }
+    }
+    if (settings.sleeping)
+    {
+        scratch.contactIslands.kickSleeping(planets, planetAccelerations, deltaTime / 2.0, settings.sleep);
+    }
+
+    accelerationsValid = true;
+}
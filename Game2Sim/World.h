@@ -0,0 +1,152 @@
+#pragma once
+
+#include "BarnesHut.h"
+#include "BodyStore.h"
+#include "Broadphase.h"
+#include "Collision.h"
+#include "Diagnostics.h"
+#include "FastMultipole.h"
+#include "GravityKernel.h"
+#include "Islands.h"
+#include "ParticleMesh.h"
+#include "Physics.h"
+#include "ThreadPool.h"
+#include <vector>
+
+//Which method is used to work out planet accelerations each frame
+enum class GravitySolver
+{
+    DirectSum,  //Every planet against every other planet, exact but O(n^2)
+    BarnesHut,  //Quadtree approximation, O(n log n)
+    ParticleMesh, //Mass on a grid convolved by FFT, O(n + g^2 log g) but blurs anything closer than a few cells
+    FastMultipole //Multipole expansions on a quadtree, O(n) and close to exact at high orders
+};
+
+const char* gravitySolverName(GravitySolver solver);
+
+//How velocities and positions are moved forward each step. All of them use the same gravity solver
+enum class Integrator
+{
+    Euler,      //Semi-implicit Euler, 1 force pass per step but energy drifts
+    Leapfrog,   //Kick-drift-kick, 1 force pass per step (reuses the last one) and keeps energy bounded
+    Yoshida,    //4th order Yoshida, 3 force passes per step but far more accurate for the same step size
+    Block       //Leapfrog where each planet takes a power of two fraction of the step, so only fast changing planets get small steps
+};
+
+const char* integratorName(Integrator integrator);
+
+//Physics options, picked once when the World is made
+struct WorldSettings
+{
+    GravitySolver solver = GravitySolver::DirectSum;
+    double theta = 0.5; //Barnes-Hut opening angle, smaller is more accurate but slower
+    std::size_t meshSize = 256; //Particle-mesh cells per side, rounded up to a power of two. Wants softening of a cell or more
+    int multipoleOrder = 16; //Fast multipole expansion order, the lowest that keeps every planet within 1e-6 of the direct sum
+    GravityKernel kernel = detectBestGravityKernel(); //Instruction set for the direct sum loop
+    unsigned threads = ThreadPool::hardwareThreads(); //Threads used for the force pass, 1 runs it all on the calling thread
+    Integrator integrator = Integrator::Euler;
+    int maxTimestepLevel = 8;       //Block steps go down to deltaTime / 2^maxTimestepLevel
+    double timestepAccuracy = 0.03; //Block step wanted is this * |acceleration| / |jerk|, smaller is more accurate
+    double softening = softeningLength; //Plummer softening length in meters, 0 turns it off
+    CollisionMode collisionMode = CollisionMode::Bounce;
+    bool sleeping = false; //Let settled piles sleep in bounce mode, see ContactIslands
+    SleepSettings sleep;
+};
+
+//Every buffer a step works in, kept between steps. The capacity only ever grows, so once the planet count
+//stops changing a step makes no heap allocations at all
+struct WorldScratch
+{
+    std::vector<Vector2d> planetAccelerations;
+    BodyStore bodyStore;
+    BarnesHutTree barnesHutTree;
+    ParticleMesh particleMesh;
+    FastMultipoleTree fastMultipoleTree;
+    UniformGrid collisionGrid;
+    MergeScratch mergeScratch;
+    ContactIslands contactIslands;
+    std::vector<double> diagnosticsRows;
+
+    //Block timesteps
+    std::vector<std::uint8_t> timestepLevels;   //Each planet steps by deltaTime / 2^level
+    std::vector<Vector2d> previousAccelerations; //At the start of each planet's current step, for its jerk
+    std::vector<Vector2d> allAccelerations;      //Full passes from solvers that can't do only some planets
+    std::vector<std::uint32_t> activePlanets;    //Planets finishing a step right now
+
+public:
+    //Makes room for planetCount planets ahead of the next step. Whatever has to grow at least doubles,
+    //so adding planets one click at a time doesn't reallocate on every click
+    void reserve(std::size_t planetCount);
+};
+
+//The whole simulation: the planets plus everything needed to step them.
+//Has no window or OS code in it, so the game, headless runs and benchmarks all drive the same physics.
+struct World
+{
+public:
+    explicit World(const WorldSettings& settings = WorldSettings());
+
+    //One physics step of deltaTime seconds: gravity, edge of world bounce + movement, then planet collisions.
+    //In merge mode the planet count can go down, and indices after a merged planet move down
+    void step(double deltaTime);
+
+    //Returns the index of the new planet
+    std::size_t addPlanet(const Planet& planet);
+    //Keeps the order of the other planets, so indices after this one move down by one
+    void removePlanet(std::size_t index);
+    void clear();
+    //Swaps every planet for these and carries on the clocks from a saved run, e.g. a loaded snapshot
+    void loadState(std::vector<Planet> newPlanets, double newSimulationTime, long long newStepCount);
+
+    //Read only, planets are changed through the functions above
+    const std::vector<Planet>& getPlanets() const { return planets; }
+    //Float copy of the planets for drawing, same order as getPlanets()
+    const std::vector<RenderPlanet>& getRenderPlanets() const { return renderPlanets; }
+    std::size_t getPlanetCount() const { return planets.size(); }
+
+    //Area planets bounce around in, in meters. The window size converted with metersPerPixel() when there is one
+    void setBounds(Vector2d size) { bounds = size; }
+    Vector2d getBounds() const { return bounds; }
+
+    //Steps taken and seconds simulated so far
+    long long getStepCount() const { return stepCount; }
+    double getSimulationTime() const { return simulationTime; }
+    //Planet accelerations worked out so far, n per full force pass. Block steps only work out the planets that need it
+    long long getForceEvaluations() const { return forceEvaluations; }
+
+    //Total energy and momentum right now, O(n^2) so call it every so many steps rather than every step
+    EnergyMomentum measureEnergyMomentum();
+
+    const WorldSettings& getSettings() const { return settings; }
+    //Can be changed between any two steps
+    void setIntegrator(Integrator integrator);
+    unsigned getThreadCount() const { return threadPool.threadCount(); }
+
+private:
+    void computePlanetAccelerations();
+    void computeAccelerationsInto(std::vector<Vector2d>& planetAccelerations);
+    void computeActiveAccelerations(); //Only scratch.activePlanets, the others keep theirs
+    void bounceOffEdges();
+    void kick(double deltaTime);  //Velocities += accelerations * deltaTime
+    void drift(double deltaTime); //Positions += velocities * deltaTime
+    void publishRenderPlanets();  //Copies the latest positions into renderPlanets
+    void mergeCollisions();       //Merge mode, also removes the merged planets' render copies
+
+    void stepEuler(double deltaTime);
+    void stepLeapfrog(double deltaTime);
+    void stepYoshida(double deltaTime);
+    void stepBlock(double deltaTime);
+    void startBlockTimesteps(double deltaTime);
+
+    WorldSettings settings;
+    std::vector<Planet> planets;
+    std::vector<RenderPlanet> renderPlanets; //Always the same size as planets
+    bool accelerationsValid = false; //scratch.planetAccelerations match the current positions, leapfrog can skip its first force pass
+    Vector2d bounds = { 19.2, 10.8 }; //A 1920x1080 window at pixels_per_meter
+    long long stepCount = 0;
+    double simulationTime = 0.0;
+    long long forceEvaluations = 0;
+
+    WorldScratch scratch;
+    ThreadPool threadPool;
+};
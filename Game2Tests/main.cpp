@@ -0,0 +1,616 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BarnesHut.h"
+#include "BodyStore.h"
+#include "Broadphase.h"
+#include "Collision.h"
+#include "FastMultipole.h"
+#include "GravityKernel.h"
+#include "ParticleMesh.h"
+#include "Scenarios.h"
+#include "Snapshot.h"
+#include "ThreadPool.h"
+#include "TripleBuffer.h"
+#include "World.h"
+
+//Quick behaviour checks for the simulation library, for catching a change that quietly breaks the physics.
+//Prints every check and returns 1 if any failed. Everything is seeded, so a failure happens every run.
+
+static int failures = 0;
+
+static void check(bool passed, const std::string& what)
+{
+    std::cout << (passed ? "ok     " : "FAILED ") << what << std::endl;
+    if (!passed)
+    {
+        ++failures;
+    }
+}
+
+//Largest |value - reference| / |reference| over every planet
+static double maxRelativeError(const std::vector<Vector2d>& values, const std::vector<Vector2d>& reference)
+{
+    double worst = 0.0;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        Vector2d difference = values[i] - reference[i];
+        double referenceSize = std::sqrt(dot(reference[i], reference[i]));
+        if (referenceSize > 0.0)
+        {
+            worst = std::max(worst, std::sqrt(dot(difference, difference)) / referenceSize);
+        }
+    }
+    return worst;
+}
+
+//sqrt(sum |value - reference|^2 / sum |reference|^2)
+static double rmsRelativeError(const std::vector<Vector2d>& values, const std::vector<Vector2d>& reference)
+{
+    double errorSum = 0.0;
+    double referenceSum = 0.0;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        Vector2d difference = values[i] - reference[i];
+        errorSum += dot(difference, difference);
+        referenceSum += dot(reference[i], reference[i]);
+    }
+    return referenceSum > 0.0 ? std::sqrt(errorSum / referenceSum) : 0.0;
+}
+
+static std::vector<Vector2d> directSum(const std::vector<Planet>& planets, double softening2)
+{
+    BodyStore bodies;
+    bodies.loadFromPlanets(planets);
+    std::vector<Vector2d> accelerations(planets.size());
+    computeDirectSumAccelerations(bodies, accelerations, GravityKernel::Scalar, softening2);
+    return accelerations;
+}
+
+//Sum of the sizes of every pull on each planet. Errors are measured against this where the pulls can cancel,
+//a planet in the middle of a cluster has almost no net acceleration and any error is huge next to it
+static std::vector<double> pullScale(const std::vector<Planet>& planets, double softening2)
+{
+    std::vector<double> scale(planets.size(), 0.0);
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        for (std::size_t j = 0; j < planets.size(); ++j)
+        {
+            if (i != j)
+            {
+                Vector2d offset = planets[j].position - planets[i].position;
+                double distance2 = dot(offset, offset);
+                double softened2 = distance2 + softening2;
+                scale[i] += G * planets[j].mass * std::sqrt(distance2) / (softened2 * std::sqrt(softened2));
+            }
+        }
+    }
+    return scale;
+}
+
+//theta 0 opens every node, so it is the direct sum with the additions in a different order.
+//Large theta is rough, but it has to be rough everywhere. A planet pulled by its own mass would stand out
+static void testBarnesHut()
+{
+    const std::vector<Planet> planets = generateScenario(Scenario::CollidingClusters, 5000, 5, { 9.6, 5.4 });
+    ThreadPool threadPool(1);
+    const double softening2 = softeningLength * softeningLength;
+    const std::vector<Vector2d> reference = directSum(planets, softening2);
+
+    std::vector<Vector2d> accelerations(planets.size());
+    BarnesHutTree tree;
+    computeBarnesHutAccelerations(planets, accelerations, tree, 0.0, softening2, threadPool);
+    check(maxRelativeError(accelerations, reference) < 1.0e-12, "barnes-hut with theta 0 matches the direct sum");
+
+    //Worst planets are about 0.13 at theta 1 and 0.48 at theta 1.5. Counting a planet's own mass put 1.5 at 0.68
+    const std::vector<double> scale = pullScale(planets, softening2);
+    for (double theta : { 1.0, 1.5 })
+    {
+        computeBarnesHutAccelerations(planets, accelerations, tree, theta, softening2, threadPool);
+        double worst = 0.0;
+        for (std::size_t i = 0; i < planets.size(); ++i)
+        {
+            Vector2d difference = accelerations[i] - reference[i];
+            worst = std::max(worst, std::sqrt(dot(difference, difference)) / scale[i]);
+        }
+        double bound = theta < 1.2 ? 0.2 : 0.55;
+        check(worst < bound, "barnes-hut with theta " + std::to_string(theta).substr(0, 3) + " keeps every planet within " + std::to_string(bound).substr(0, 4) + " of its total pull");
+    }
+
+    //A light planet in the corner of the root next to a heavy one. Its own mass used to be counted, 33% off at theta 1
+    const std::vector<Planet> pair = { Planet{ { 0.0, 0.0 }, 0.05, 1.0e11, { 0.0, 0.0 } }, Planet{ { 100.0, 100.0 }, 0.05, 1.0e12, { 0.0, 0.0 } } };
+    std::vector<Vector2d> pairAccelerations(pair.size());
+    computeBarnesHutAccelerations(pair, pairAccelerations, tree, 1.0, softening2, threadPool);
+    check(maxRelativeError(pairAccelerations, directSum(pair, softening2)) < 1.0e-12, "barnes-hut never pulls a planet with its own mass");
+}
+
+//Splitting a pass across threads only changes which thread works out which planet, never the order of the additions
+//for any one planet, so every solver has to give the same bits whatever the thread count
+static void testThreadCountDeterminism()
+{
+    const std::vector<Planet> planets = generateScenario(Scenario::CollidingClusters, 3000, 6, { 9.6, 5.4 });
+    const double softening2 = softeningLength * softeningLength;
+    BodyStore bodies;
+    bodies.loadFromPlanets(planets);
+    BarnesHutTree barnesHutTree;
+    ParticleMesh mesh;
+    FastMultipoleTree multipoleTree;
+
+    auto accelerationsWith = [&](GravitySolver solver, unsigned threadCount)
+    {
+        ThreadPool threadPool(threadCount);
+        std::vector<Vector2d> accelerations(planets.size());
+        switch (solver)
+        {
+        case GravitySolver::DirectSum:
+            threadPool.parallelFor(planets.size(), 64, [&](std::size_t begin, std::size_t end, unsigned)
+            {
+                computeDirectSumAccelerations(bodies, accelerations, detectBestGravityKernel(), softening2, begin, end);
+            });
+            break;
+        case GravitySolver::BarnesHut:
+            computeBarnesHutAccelerations(planets, accelerations, barnesHutTree, 0.5, softening2, threadPool);
+            break;
+        case GravitySolver::ParticleMesh:
+            computeParticleMeshAccelerations(planets, accelerations, mesh, 256, softening2, threadPool);
+            break;
+        case GravitySolver::FastMultipole:
+            computeFastMultipoleAccelerations(planets, accelerations, multipoleTree, WorldSettings().multipoleOrder, softening2, threadPool);
+            break;
+        }
+        return accelerations;
+    };
+
+    for (GravitySolver solver : { GravitySolver::DirectSum, GravitySolver::BarnesHut, GravitySolver::ParticleMesh, GravitySolver::FastMultipole })
+    {
+        std::vector<Vector2d> single = accelerationsWith(solver, 1);
+        std::vector<Vector2d> several = accelerationsWith(solver, 4);
+        check(single == several, std::string(gravitySolverName(solver)) + " gives the same bits on 1 and 4 threads");
+    }
+}
+
+//A 20 x 20 square of planets just overlapping their neighbours, so the whole square is one contact island.
+//Each planet starts with a small random velocity that the collisions have to settle
+static std::vector<Planet> makePile(Vector2d corner, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> jitter(-0.05, 0.05);
+    std::vector<Planet> pile;
+    for (int x = 0; x < 20; ++x)
+    {
+        for (int y = 0; y < 20; ++y)
+        {
+            pile.push_back(Planet{ corner + Vector2d(x * 0.0995, y * 0.0995), 0.05, 1.0e8, { jitter(random), jitter(random) }, sf::Color::White });
+        }
+    }
+    return pile;
+}
+
+static Vector2d totalMomentum(const std::vector<Planet>& planets, std::size_t begin, std::size_t end)
+{
+    Vector2d momentum = { 0.0, 0.0 };
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        momentum += planets[i].velocity * planets[i].mass;
+    }
+    return momentum;
+}
+
+//Steps until the number of planets asleep passes the test or maxSteps run out. Returns whether it did
+template <typename Test>
+static bool stepUntilAsleep(World& world, double deltaTime, int maxSteps, Test test)
+{
+    for (int i = 0; i < maxSteps; ++i)
+    {
+        if (test(ContactIslands::countAsleep(world.getPlanets())))
+        {
+            return true;
+        }
+        world.step(deltaTime);
+    }
+    return test(ContactIslands::countAsleep(world.getPlanets()));
+}
+
+static void testSleepingIslands()
+{
+    const double deltaTime = 0.004;
+    WorldSettings settings;
+    settings.sleeping = true;
+
+    World world(settings);
+    world.setBounds({ 40.0, 40.0 });
+    for (const Planet& planet : makePile({ 5.0, 5.0 }, 7))
+    {
+        world.addPlanet(planet);
+    }
+    const std::size_t pileSize = world.getPlanetCount();
+    check(stepUntilAsleep(world, deltaTime, 3000, [&](std::size_t asleep) { return asleep == pileSize; }), "a settled pile falls asleep");
+
+    //Its own weight is held up by its contacts, so on its own it never wakes itself
+    for (int i = 0; i < 1500; ++i)
+    {
+        world.step(deltaTime);
+    }
+    check(ContactIslands::countAsleep(world.getPlanets()) == pileSize, "a sleeping pile on its own stays asleep");
+
+    //A heavy planet far off pulls the sleeping pile towards it. Nothing inside the pile is solved while it sleeps,
+    //so whatever momentum the heavy planet picks up the pile has to pick up the opposite of
+    Vector2d pileBefore = totalMomentum(world.getPlanets(), 0, pileSize);
+    std::size_t heavy = world.addPlanet(Planet{ { 19.0, 6.0 }, 0.05, 1.0e10, { 0.0, 0.0 }, sf::Color::White });
+    for (int i = 0; i < 500; ++i)
+    {
+        world.step(deltaTime);
+    }
+    Vector2d pileGain = totalMomentum(world.getPlanets(), 0, pileSize) - pileBefore;
+    Vector2d heavyGain = totalMomentum(world.getPlanets(), heavy, heavy + 1);
+    Vector2d imbalance = pileGain + heavyGain;
+    check(ContactIslands::countAsleep(world.getPlanets()) == pileSize && pileGain.x > 0.0
+        && std::sqrt(dot(imbalance, imbalance)) < 1.0e-9 * std::sqrt(dot(heavyGain, heavyGain)), "a sleeping pile keeps the total momentum while it is pulled");
+
+    //Anything awake hitting the pile wakes it
+    world.addPlanet(Planet{ { 2.0, 5.95 }, 0.05, 1.0e8, { 2.0, 0.0 }, sf::Color::White });
+    check(stepUntilAsleep(world, deltaTime, 2000, [](std::size_t asleep) { return asleep == 0; }), "a planet hitting a sleeping pile wakes it");
+
+    //So does a heavy planet passing close without touching, it pulls much harder on the near side of the pile
+    World flyby(settings);
+    flyby.setBounds({ 40.0, 40.0 });
+    for (const Planet& planet : makePile({ 5.0, 5.0 }, 8))
+    {
+        flyby.addPlanet(planet);
+    }
+    bool fellAsleep = stepUntilAsleep(flyby, deltaTime, 3000, [&](std::size_t asleep) { return asleep == pileSize; });
+    flyby.addPlanet(Planet{ { 1.0, 3.0 }, 0.05, 1.0e11, { 0.0, 3.0 }, sf::Color::White });
+    check(fellAsleep && stepUntilAsleep(flyby, deltaTime, 1000, [](std::size_t asleep) { return asleep == 0; }), "a heavy planet passing close wakes a sleeping pile");
+
+    //While nothing is asleep, sleeping mode has to solve the collisions exactly like plain bounce mode.
+    //Fewer steps than it takes to fall asleep, through a crowded field that has plenty of collisions
+    WorldSettings bounceSettings;
+    World bounce(bounceSettings);
+    World sleeping(settings);
+    for (World* copy : { &bounce, &sleeping })
+    {
+        copy->setBounds({ 40.0, 40.0 });
+        for (const Planet& planet : generateScenario(Scenario::CollidingClusters, 1000, 9, { 9.6, 5.4 }))
+        {
+            copy->addPlanet(planet);
+        }
+    }
+    for (int i = 0; i < settings.sleep.quietStepsToSleep - 1; ++i)
+    {
+        bounce.step(deltaTime);
+        sleeping.step(deltaTime);
+    }
+    bool same = ContactIslands::countAsleep(sleeping.getPlanets()) == 0;
+    for (std::size_t i = 0; same && i < bounce.getPlanetCount(); ++i)
+    {
+        same = bounce.getPlanets()[i].position == sleeping.getPlanets()[i].position && bounce.getPlanets()[i].velocity == sleeping.getPlanets()[i].velocity;
+    }
+    check(same, "sleeping mode with nothing asleep matches bounce mode bit for bit");
+}
+
+//A tight binary in a wide, slow field. Only the binary needs small steps, so block steps should cost a fraction of
+//giving everyone the binary's step while keeping energy just as well
+static void testBlockTimesteps()
+{
+    std::mt19937 random(10);
+    std::uniform_real_distribution<double> position(-8.0, 8.0);
+    std::uniform_real_distribution<double> velocity(-0.05, 0.05);
+    std::vector<Planet> planets;
+
+    //Two 1e9 kg planets 5 cm apart on a circular orbit, about a fifth of a second round. Softened like the force pass
+    const double binaryMass = 1.0e9;
+    const double separation = 0.05;
+    const double softened2 = separation * separation + softeningLength * softeningLength;
+    const double orbitalSpeed = std::sqrt(G * binaryMass * separation / (softened2 * std::sqrt(softened2)) * separation / 2.0);
+    planets.push_back(Planet{ { 50.0 - separation / 2.0, 50.0 }, 0.01, binaryMass, { 0.0, -orbitalSpeed }, sf::Color::White });
+    planets.push_back(Planet{ { 50.0 + separation / 2.0, 50.0 }, 0.01, binaryMass, { 0.0, orbitalSpeed }, sf::Color::White });
+    //98 light planets at least 3 m out, slow enough that a whole 1/60 s step is plenty for them
+    while (planets.size() < 100)
+    {
+        Vector2d offset = { position(random), position(random) };
+        if (dot(offset, offset) > 9.0)
+        {
+            planets.push_back(Planet{ Vector2d(50.0, 50.0) + offset, 0.01, 1.0e7, { velocity(random), velocity(random) }, sf::Color::White });
+        }
+    }
+
+    const double deltaTime = 1.0 / 60.0;
+    const int steps = 180;
+    auto run = [&](Integrator integrator, int substeps, long long& forceEvaluations)
+    {
+        WorldSettings settings;
+        settings.integrator = integrator;
+        World world(settings);
+        world.setBounds({ 100.0, 100.0 });
+        for (const Planet& planet : planets)
+        {
+            world.addPlanet(planet);
+        }
+        double startEnergy = world.measureEnergyMomentum().total();
+        for (int i = 0; i < steps * substeps; ++i)
+        {
+            world.step(deltaTime / substeps);
+        }
+        forceEvaluations = world.getForceEvaluations();
+        return std::abs(world.measureEnergyMomentum().total() - startEnergy) / std::abs(startEnergy);
+    };
+
+    //Leapfrog at 1/60 s drifts by about 3e-3 here, at 1/960 s by 1e-4. Block steps get the same 1e-4 for 12 times fewer evaluations
+    long long blockEvaluations, sharedEvaluations;
+    double blockDrift = run(Integrator::Block, 1, blockEvaluations);
+    double sharedDrift = run(Integrator::Leapfrog, 16, sharedEvaluations);
+    check(blockEvaluations * 4 < sharedEvaluations, "block steps need under a quarter of the force evaluations of everyone at the binary's step");
+    check(blockDrift < 5.0e-4 && blockDrift < 2.0 * sharedDrift, "block steps keep energy as well as everyone at the binary's step");
+}
+
+//The SIMD loops only change the order of a few additions, so they should agree with plain C++ to rounding
+static void testGravityKernels()
+{
+    //Not a multiple of 4, so the padded lanes at the end of the store are used too
+    const std::vector<Planet> planets = generateScenario(Scenario::PlummerSphere, 1003, 1, { 9.6, 5.4 });
+    const double softening2 = softeningLength * softeningLength;
+    const std::vector<Vector2d> reference = directSum(planets, softening2);
+
+    BodyStore bodies;
+    bodies.loadFromPlanets(planets);
+    for (GravityKernel kernel : { GravityKernel::Sse, GravityKernel::Avx2 })
+    {
+        if (!isGravityKernelSupported(kernel))
+        {
+            std::cout << "skip   " << gravityKernelName(kernel) << " kernel, not supported by this CPU" << std::endl;
+            continue;
+        }
+        std::vector<Vector2d> accelerations(planets.size());
+        computeDirectSumAccelerations(bodies, accelerations, kernel, softening2);
+        check(maxRelativeError(accelerations, reference) < 1.0e-11, std::string(gravityKernelName(kernel)) + " kernel matches the scalar kernel");
+    }
+}
+
+//Every touching pair has to come out of the broadphase, whatever mix of sizes the planets are
+static void testBroadphase()
+{
+    std::mt19937 random(4);
+    std::uniform_real_distribution<double> position(0.0, 2.0);
+    std::uniform_real_distribution<double> smallRadius(0.005, 0.05);
+    std::uniform_real_distribution<double> largeRadius(0.1, 0.3);
+
+    //Mostly small planets with a few large ones, so the cells are sized by planets most pairs are far smaller than
+    std::vector<Planet> planets;
+    for (int i = 0; i < 3000; ++i)
+    {
+        double radius = i % 300 == 0 ? largeRadius(random) : smallRadius(random);
+        planets.push_back(Planet{ { position(random), position(random) }, radius, 1.0e9, { 0.0, 0.0 }, sf::Color::White });
+    }
+
+    UniformGrid grid;
+    const std::vector<UniformGrid::PlanetPair>& candidates = grid.findCandidatePairs(planets);
+    check(std::is_sorted(candidates.begin(), candidates.end()), "broadphase pairs come out sorted");
+
+    bool allFound = true;
+    std::size_t touching = 0;
+    for (std::uint32_t i = 0; i < planets.size(); ++i)
+    {
+        for (std::uint32_t j = i + 1; j < planets.size(); ++j)
+        {
+            Vector2d offset = planets[j].position - planets[i].position;
+            double reach = planets[i].radius + planets[j].radius;
+            if (dot(offset, offset) <= reach * reach)
+            {
+                ++touching;
+                allFound = allFound && std::binary_search(candidates.begin(), candidates.end(), UniformGrid::PlanetPair(i, j));
+            }
+        }
+    }
+    check(touching > 0 && allFound, "broadphase finds every touching pair (" + std::to_string(touching) + ")");
+}
+
+//Merging is a perfectly inelastic collision, mass and momentum have to come out exactly as they went in
+static void testMergeConservesMomentum()
+{
+    std::mt19937 random(3);
+    std::uniform_real_distribution<double> position(0.0, 1.0);
+    std::uniform_real_distribution<double> velocity(-1.0, 1.0);
+    std::uniform_real_distribution<double> mass(1.0e9, 1.0e11);
+
+    //Crowded enough that most planets touch, including long chains
+    std::vector<Planet> planets;
+    for (int i = 0; i < 2000; ++i)
+    {
+        planets.push_back(Planet{ { position(random), position(random) }, 0.015, mass(random), { velocity(random), velocity(random) }, sf::Color::White });
+    }
+
+    auto totals = [](const std::vector<Planet>& planets, double& totalMass, Vector2d& momentum)
+    {
+        totalMass = 0.0;
+        momentum = { 0.0, 0.0 };
+        for (const Planet& planet : planets)
+        {
+            totalMass += planet.mass;
+            momentum += planet.velocity * planet.mass;
+        }
+    };
+
+    double massBefore, massAfter;
+    Vector2d momentumBefore, momentumAfter;
+    totals(planets, massBefore, momentumBefore);
+
+    //Momentum is compared against the size of the momenta that went into it, the total itself is close to 0
+    double momentumScale = 0.0;
+    for (const Planet& planet : planets)
+    {
+        momentumScale += planet.mass * std::sqrt(dot(planet.velocity, planet.velocity));
+    }
+
+    UniformGrid collisionGrid;
+    MergeScratch scratch;
+    std::size_t removed = mergeTouchingPlanets(planets, collisionGrid, scratch);
+    totals(planets, massAfter, momentumAfter);
+    Vector2d momentumChange = momentumAfter - momentumBefore;
+
+    check(removed > 0 && planets.size() == 2000 - removed, "touching planets merge");
+    check(std::abs(massAfter - massBefore) <= 1.0e-12 * massBefore, "merging keeps the total mass");
+    check(std::sqrt(dot(momentumChange, momentumChange)) <= 1.0e-12 * momentumScale, "merging keeps the total momentum");
+}
+
+static void testTripleBuffer()
+{
+    TripleBuffer<int> buffer;
+    check(!buffer.acquire(), "triple buffer has nothing to acquire before the first publish");
+
+    buffer.writeSlot() = 1;
+    buffer.publish();
+    check(buffer.acquire() && buffer.readSlot() == 1, "triple buffer hands over a published value");
+    check(!buffer.acquire() && buffer.readSlot() == 1, "triple buffer keeps the value until something new is published");
+
+    buffer.writeSlot() = 2;
+    buffer.publish();
+    buffer.writeSlot() = 3;
+    buffer.publish();
+    check(buffer.acquire() && buffer.readSlot() == 3, "triple buffer skips to the newest value");
+
+    //Across threads: every value the reader sees has to be whole and never older than the last one it saw
+    struct Pair
+    {
+        long long first = 0;
+        long long second = 0;
+    };
+    TripleBuffer<Pair> pairs;
+    std::atomic<bool> done{ false };
+    std::thread writer([&]
+    {
+        for (long long i = 1; i <= 200000; ++i)
+        {
+            pairs.writeSlot() = { i, -i };
+            pairs.publish();
+        }
+        done = true;
+    });
+
+    bool whole = true;
+    bool inOrder = true;
+    long long last = 0;
+    while (true)
+    {
+        //Read before acquiring, so once the writer is done one more acquire is sure to pick up its last value
+        bool writerDone = done;
+        if (pairs.acquire())
+        {
+            const Pair& value = pairs.readSlot();
+            whole = whole && value.first == -value.second;
+            inOrder = inOrder && value.first > last;
+            last = value.first;
+        }
+        else if (writerDone)
+        {
+            break;
+        }
+    }
+    writer.join();
+    check(whole && inOrder && last == 200000, "triple buffer passes whole values in order between threads");
+}
+
+//Particle-mesh is only close with softening of a couple of cells, see ParticleMesh.h. Around 1% rms there
+static void testParticleMesh()
+{
+    const std::vector<Planet> planets = generateScenario(Scenario::PlummerSphere, 5000, 4, { 9.6, 5.4 });
+    ThreadPool threadPool(1);
+    double extent = 0.0;
+    for (const Planet& planet : planets)
+    {
+        extent = std::max({ extent, std::abs(planet.position.x - 9.6) * 2.0, std::abs(planet.position.y - 5.4) * 2.0 });
+    }
+    const std::size_t meshSize = 256;
+    const double meshSoftening = 2.0 * ParticleMesh::cellSizeFor(extent, meshSize);
+    const std::vector<Vector2d> reference = directSum(planets, meshSoftening * meshSoftening);
+
+    std::vector<Vector2d> accelerations(planets.size());
+    ParticleMesh mesh;
+    computeParticleMeshAccelerations(planets, accelerations, mesh, meshSize, meshSoftening * meshSoftening, threadPool);
+    check(rmsRelativeError(accelerations, reference) < 0.03, "particle-mesh with two cells of softening is within 3% rms of the direct sum");
+}
+
+//The fast multipole default order is meant to keep every planet within 1e-6 of the direct sum
+static void testFastMultipole()
+{
+    const std::vector<Planet> planets = generateScenario(Scenario::PlummerSphere, 5000, 4, { 9.6, 5.4 });
+    ThreadPool threadPool(1);
+    const double softening2 = softeningLength * softeningLength;
+    const std::vector<Vector2d> reference = directSum(planets, softening2);
+
+    std::vector<Vector2d> accelerations(planets.size());
+    FastMultipoleTree tree;
+    computeFastMultipoleAccelerations(planets, accelerations, tree, WorldSettings().multipoleOrder, softening2, threadPool);
+    check(maxRelativeError(accelerations, reference) < 1.0e-6, "fast multipole at the default order is within 1e-6 of the direct sum");
+}
+
+static void testSnapshotRoundTrip()
+{
+    const std::string path = "game2tests_snapshot.g2s";
+    std::vector<Planet> planets = generateScenario(Scenario::CollidingClusters, 500, 2, { 9.6, 5.4 });
+    for (std::size_t i = 0; i < planets.size(); ++i)
+    {
+        planets[i].color = sf::Color(static_cast<std::uint8_t>(i), static_cast<std::uint8_t>(i * 7), static_cast<std::uint8_t>(i * 13));
+    }
+
+    check(saveSnapshot(path, planets, 12.5, 750), "snapshot saves");
+    check(isSnapshotFile(path), "saved file is recognised as a snapshot");
+
+    SnapshotContents loaded;
+    std::string error;
+    bool read = loadSnapshot(path, loaded, error);
+    check(read, "snapshot loads" + (read ? std::string() : ": " + error));
+
+    bool same = loaded.planets.size() == planets.size() && loaded.simulationTime == 12.5 && loaded.stepCount == 750;
+    for (std::size_t i = 0; same && i < planets.size(); ++i)
+    {
+        const Planet& a = planets[i];
+        const Planet& b = loaded.planets[i];
+        same = a.position == b.position && a.velocity == b.velocity && a.mass == b.mass && a.radius == b.radius && a.color == b.color;
+    }
+    check(same, "loaded snapshot is bit for bit what was saved");
+
+    //Cut off part way through the planets, has to be refused rather than read past the end
+    std::vector<char> bytes;
+    {
+        std::ifstream file(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size() / 2));
+    }
+    check(!loadSnapshot(path, loaded, error), "cut short snapshot is refused");
+
+    std::remove(path.c_str());
+}
+
+int main()
+{
+    testBarnesHut();
+    testThreadCountDeterminism();
+    testBroadphase();
+    testSleepingIslands();
+    testBlockTimesteps();
+    testGravityKernels();
+    testMergeConservesMomentum();
+    testTripleBuffer();
+    testParticleMesh();
+    testFastMultipole();
+    testSnapshotRoundTrip();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}